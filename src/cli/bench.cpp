@@ -0,0 +1,323 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <util/error.hpp>
+#include <util/file_utils.hpp>
+#include <util/trace.hpp>
+#include <util/rotation.hpp>
+#include <util/io/package_manager.hpp>
+#include <cli/bench.hpp>
+#include <cli/text_io_handler.hpp>
+#include <data/game.hpp>
+#include <data/stylesheet.hpp>
+#include <data/set.hpp>
+#include <data/card.hpp>
+#include <data/field/text.hpp>
+#include <data/field/choice.hpp>
+#include <data/format/formats.hpp>
+#include <render/text/viewer.hpp>
+#include <gfx/gfx.hpp>
+#include <gfx/image_cache.hpp>
+#include <script/parser.hpp>
+#include <script/context.hpp>
+#include <script/to_value.hpp>
+#include <wx/filename.h>
+#include <wx/file.h>
+#include <chrono>
+#include <random>
+
+using namespace std::chrono;
+
+// ----------------------------------------------------------------------------- : Synthetic sets
+
+// The generated sets only depend on the number of cards.
+// minstd_rand is fully specified by the standard, so this is the same on all platforms.
+
+const Char* bench_adjectives[] = {
+  _("Ancient"), _("Blazing"), _("Crimson"), _("Drowned"), _("Eternal"), _("Feral"), _("Gilded"), _("Hollow"),
+  _("Iron"), _("Jade"), _("Lost"), _("Mire"), _("Night"), _("Obsidian"), _("Pale"), _("Restless")
+};
+const Char* bench_nouns[] = {
+  _("Angel"), _("Behemoth"), _("Cartographer"), _("Drake"), _("Elemental"), _("Familiar"), _("Golem"), _("Hydra"),
+  _("Inquisitor"), _("Juggernaut"), _("Knight"), _("Leviathan"), _("Mystic"), _("Nomad"), _("Oracle"), _("Phoenix")
+};
+const Char* bench_colors[] = {
+  _("white"), _("blue"), _("black"), _("red"), _("green"), _("colorless")
+};
+const Char* bench_costs[] = {
+  _("1W"), _("2U"), _("1BB"), _("3R"), _("2GG"), _("4"), _("WU"), _("5RG")
+};
+const Char* bench_types[] = {
+  _("Creature - Angel"), _("Creature - Drake Mystic"), _("Artifact Creature - Golem"), _("Creature - Human Knight"),
+  _("Instant"), _("Sorcery"), _("Enchantment"), _("Legendary Creature - Elemental Hydra")
+};
+// Some of these contain keywords, some contain words that only start like a keyword
+const Char* bench_abilities[] = {
+  _("Flying"), _("Haste"), _("Vigilance"), _("Flying, haste"), _("Scry 2."), _("Cycling 2W"), _("Bushido 1"),
+  _("When this creature enters the battlefield, draw a card."),
+  _("T: Add one mana of any color."),
+  _("Creatures you control get +1/+1 until end of turn. Scry 1."),
+  _("Whenever another creature dies, you may pay 1. If you do, put a +1/+1 counter on this creature."),
+  _("Destroy target artifact or enchantment. Its controller gains 3 life."),
+  _("Flyingfish and hastened creatures are not keywords, but flying creatures can't block this."),
+  _("Counter target spell unless its controller pays 2.")
+};
+const Char* bench_flavor[] = {
+  _(""), _(""), _("The map ends here. The world does not."), _("It remembers every storm, and forgives none of them."),
+  _("\"Patience is also a weapon.\""), _("")
+};
+
+template <typename T, size_t N>
+const T& bench_pick(const T (&xs)[N], std::minstd_rand& rng) {
+  return xs[rng() % N];
+}
+
+/// Generate a set with the given number of cards, stores the unexpanded rule texts in rule_texts
+SetP generate_set(const StyleSheetP& stylesheet, size_t card_count, vector<String>& rule_texts) {
+  std::minstd_rand rng(20240101);
+  SetP set = make_intrusive<Set>(stylesheet);
+  set->value<TextValue>(_("title")).value.assign(_("Benchmark set"));
+  for (size_t i = 0 ; i < card_count ; ++i) {
+    CardP card = make_intrusive<Card>(*set->game);
+    // note: the order of evaluation of function arguments is unspecified, so use one rng() per statement
+    String name = bench_pick(bench_adjectives, rng);
+    name += _(" ");
+    name += bench_pick(bench_nouns, rng);
+    String rule_text;
+    for (int n = 1 + rng() % 4 ; n > 0 ; --n) {
+      if (!rule_text.empty()) rule_text += _("\n");
+      rule_text += bench_pick(bench_abilities, rng);
+    }
+    int power = rng() % 7, toughness = 1 + rng() % 7;
+    card->value<TextValue>(_("name"))       .value.assign(name);
+    card->value<TextValue>(_("cost"))       .value.assign(bench_pick(bench_costs, rng));
+    card->value<ChoiceValue>(_("color"))    .value.assign(bench_pick(bench_colors, rng));
+    card->value<TextValue>(_("type"))       .value.assign(bench_pick(bench_types, rng));
+    card->value<TextValue>(_("rule_text"))  .value.assign(rule_text);
+    card->value<TextValue>(_("flavor_text")).value.assign(bench_pick(bench_flavor, rng));
+    card->value<TextValue>(_("power"))      .value.assign(String::Format(_("%d/%d"), power, toughness));
+    set->cards.push_back(card);
+    rule_texts.push_back(rule_text);
+  }
+  return set;
+}
+
+// ----------------------------------------------------------------------------- : Reporting
+
+/// Collects the results of the benchmarks as JSON lines
+class BenchReport {
+public:
+  BenchReport(size_t card_count, int repetitions)
+    : card_count(card_count), repetitions(repetitions)
+  {}
+
+  /// Report a benchmark, seconds is the time of each repetition, items is the work done per repetition
+  /** extra is added to the JSON object as it is, it should be empty or start with a comma */
+  void add(const char* name, const vector<double>& seconds, size_t items, const std::string& extra = std::string()) {
+    double best = *min_element(seconds.begin(), seconds.end());
+    double mean = 0;
+    FOR_EACH_CONST(s, seconds) mean += s;
+    mean /= seconds.size();
+    char buf[500];
+    snprintf(buf, sizeof(buf),
+      "{\"benchmark\":\"%s\",\"version\":\"%s\",\"cards\":%u,\"repetitions\":%d,\"items\":%u,"
+      "\"first_ms\":%.3f,\"best_ms\":%.3f,\"mean_ms\":%.3f,\"items_per_second\":%.1f",
+      name, version().c_str(), (unsigned)card_count, repetitions, (unsigned)items,
+      seconds.front() * 1000, best * 1000, mean * 1000, best > 0 ? items / best : 0.0);
+    out += buf;
+    out += extra;
+    out += "}\n";
+  }
+
+  /// Write the report to a file, or to the console if filename is empty
+  void write(const String& filename) {
+    if (filename.empty()) {
+      cli << String::FromUTF8(out.data(), out.size());
+      cli.flush();
+    } else {
+      wxFile file;
+      if (!file.Create(filename, true) || !file.Write(out.data(), out.size())) {
+        throw Error(_("Unable to write benchmark results: ") + filename);
+      }
+    }
+  }
+
+private:
+  size_t      card_count;
+  int         repetitions;
+  std::string out;
+
+  static std::string version() {
+    return (app_version.toString() + version_suffix).ToStdString();
+  }
+};
+
+/// Forget the results cached in memory by rendering, so each repetition does the same work
+void bench_clear_caches() {
+  TextViewer::clearLayoutMemo();
+  clear_text_extent_cache();
+  clear_text_coverage_cache();
+  generated_image_cache.clear();
+}
+
+/// Time a function over a number of repetitions, returns the time of each in seconds
+/** The caches are cleared before each repetition, this is not included in the time */
+template <typename F>
+vector<double> bench_time(int repetitions, F f) {
+  vector<double> seconds;
+  for (int i = 0 ; i < repetitions ; ++i) {
+    bench_clear_caches();
+    steady_clock::time_point start = steady_clock::now();
+    f();
+    seconds.push_back(duration<double>(steady_clock::now() - start).count());
+  }
+  return seconds;
+}
+
+// ----------------------------------------------------------------------------- : Benchmarks
+
+void run_benchmarks(const vector<String>& args) {
+  // options
+  String fixture_dir, output_filename;
+  long card_count = 500, repetitions = 3;
+  for (size_t i = 0 ; i < args.size() ; ++i) {
+    const String& arg = args[i];
+    if ((arg == _("--cards") || arg == _("--repeat")) && i + 1 < args.size()) {
+      long& n = arg == _("--cards") ? card_count : repetitions;
+      if (!args[i+1].ToLong(&n) || n < 1) {
+        throw Error(_("Invalid number for ") + arg + _(": ") + args[i+1]);
+      }
+      ++i;
+    } else if (arg == _("--output") && i + 1 < args.size()) {
+      output_filename = args[++i];
+    } else if (!starts_with(arg, _("--"))) {
+      fixture_dir = arg;
+    } else {
+      throw Error(_("Invalid argument for --bench: ") + arg);
+    }
+  }
+  if (fixture_dir.empty()) {
+    throw Error(_("No fixture directory specified for --bench"));
+  }
+  package_manager.setLocalDirectory(fixture_dir);
+  BenchReport report(card_count, repetitions);
+  // images cached on disk by earlier runs would make the first run differ from later ones
+  generated_image_cache.disk_budget = 0;
+
+  // generate
+  GameP game = Game::byName(_("bench"));
+  StyleSheetP stylesheet = StyleSheet::byGameAndName(*game, _("standard"));
+  vector<String> rule_texts;
+  SetP generated = generate_set(stylesheet, card_count, rule_texts);
+
+  // zip save, always writes a new file
+  String filename = wxFileName::CreateTempFileName(_("mse-bench"));
+  vector<double> seconds = bench_time(repetitions, [&] {
+    generated->saveCopy(filename);
+  });
+  report.add("set save", seconds, card_count, ",\"bytes\":" + std::to_string(wxFileName::GetSize(filename).GetValue()));
+
+  // load, this includes updating all scripts
+  SetP set;
+  seconds = bench_time(repetitions, [&] {
+    set = make_intrusive<Set>();
+    set->open(filename);
+  });
+  report.add("set load", seconds, card_count);
+  remove_file(filename);
+  remove_file(filename + _(".bak"));
+
+  // update all scripts of the loaded set, counting the script values that are allocated
+  auto update_all = [&] {
+    set->validate();
+  };
+  script_value_counting = true;
+  script_value_count = 0;
+  seconds = bench_time(repetitions, update_all);
+  report.add("update all", seconds, card_count, ",\"script_values\":" + std::to_string(script_value_count / repetitions));
+  // the same, allocating all integers
+  small_ints_enabled = false;
+  script_value_count = 0;
+  seconds = bench_time(repetitions, update_all);
+  small_ints_enabled = true;
+  script_value_counting = false;
+  report.add("update all without small ints", seconds, card_count, ",\"script_values\":" + std::to_string(script_value_count / repetitions));
+  // the same, looking up all members by reflection
+  member_caches_enabled = false;
+  seconds = bench_time(repetitions, update_all);
+  member_caches_enabled = true;
+  report.add("update all without member cache", seconds, card_count);
+
+  // member access, this is what the member caches are for
+  ScriptP members = parse(
+    _("for i from 1 to 20 do ")
+    _("  card.name + card.cost + card.type + card.power + card.rule_text + card.flavor_text + set.title")
+  );
+  auto access_members = [&] {
+    FOR_EACH(card, set->cards) {
+      Context& ctx = set->getContext(card);
+      ctx.eval(*members, false);
+    }
+  };
+  seconds = bench_time(repetitions, access_members);
+  report.add("member access", seconds, card_count * 20 * 7);
+  member_caches_enabled = false;
+  seconds = bench_time(repetitions, access_members);
+  member_caches_enabled = true;
+  report.add("member access without cache", seconds, card_count * 20 * 7);
+
+  // keyword expansion of the unexpanded rule texts
+  ScriptP expand = parse(_("expand_keywords(input, default_expand: { true }, combine: reminder_combine)"));
+  seconds = bench_time(repetitions, [&] {
+    for (size_t i = 0 ; i < set->cards.size() ; ++i) {
+      Context& ctx = set->getContext(set->cards[i]);
+      LocalScope scope(ctx);
+      ctx.setVariable(_("input"), to_script(rule_texts[i]));
+      ctx.eval(*expand, false);
+    }
+  });
+  report.add("keyword expansion", seconds, card_count);
+
+  // render all cards, without tracing, since recording the trace events takes a lock
+  bool tracing = trace_enabled;
+  trace_enabled = false;
+  size_t attempts_before = TextViewer::layoutAttempts();
+  CardImageRenderer renderer(set);
+  seconds = bench_time(repetitions, [&] {
+    FOR_EACH(card, set->cards) renderer.render(card);
+  });
+  size_t attempts = TextViewer::layoutAttempts() - attempts_before;
+  report.add("card render", seconds, card_count, ",\"layout_attempts\":" + std::to_string(attempts / repetitions));
+  // the same, but drawing all text instead of using the cached coverage
+  resampled_text_cache_enabled = false;
+  seconds = bench_time(repetitions, [&] {
+    FOR_EACH(card, set->cards) renderer.render(card);
+  });
+  resampled_text_cache_enabled = true;
+  report.add("card render without text cache", seconds, card_count);
+  #if USE_TRACING
+    // text layout is measured with the trace of a separate rendering pass, starting with the same empty caches
+    if (tracing) trace_enabled = true;
+    else         trace_start();
+    long long layout_before = trace_total_time("prepare text");
+    for (long i = 0 ; i < repetitions ; ++i) {
+      bench_clear_caches();
+      FOR_EACH(card, set->cards) renderer.render(card);
+    }
+    long long layout_time = trace_total_time("prepare text") - layout_before;
+    if (!tracing) trace_stop();
+    // only the total over all repetitions is known, so report the average for each
+    vector<double> layout_seconds(repetitions, layout_time / 1e6 / repetitions);
+    report.add("text layout", layout_seconds, card_count);
+  #else
+    trace_enabled = tracing;
+  #endif
+
+  report.write(output_filename);
+}
@@ -0,0 +1,25 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#pragma once
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+
+// ----------------------------------------------------------------------------- : Benchmarks
+
+/// Run the benchmarks, for the --bench command line option
+/** args are the command line arguments following --bench:
+ *    DIR [--cards N] [--repeat N] [--output FILE]
+ *  where DIR contains the bench.mse-game and bench-standard.mse-style packages.
+ *
+ *  A set of N synthetic cards is generated, and the time taken to save it, load it,
+ *  update all scripts, expand keywords, lay out text and render the cards is measured.
+ *  The results are written as JSON, one object per line.
+ *  Throws an Error if the fixtures can not be loaded or the output can not be written.
+ */
+void run_benchmarks(const vector<String>& args);
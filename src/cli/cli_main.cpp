@@ -11,10 +11,17 @@
 #include <cli/cli_main.hpp>
 #include <cli/text_io_handler.hpp>
 #include <script/functions/functions.hpp>
+#include <script/functions/util.hpp>
 #include <script/profiler.hpp>
+#include <util/trace.hpp>
 #include <data/format/formats.hpp>
+#include <data/card.hpp>
+#include <data/field/text.hpp>
+#include <data/action/set.hpp>
+#include <data/action/value.hpp>
 #include <wx/process.h>
 #include <wx/wfstream.h>
+#include <wx/filename.h>
 
 String read_utf8_line(wxInputStream& input, bool until_eof = false);
 
@@ -77,7 +84,94 @@ String read_file(String const& filename) {
   return read_utf8_line(stream, true);
 }
 
-bool run_script_file(String const& filename) {
+// ----------------------------------------------------------------------------- : Running : Changing the set
+
+// These functions change the set with actions, and save and load sets, in the same way as the GUI does.
+// They are only available to script files that are run with a set, for testing how the set responds to changes.
+
+SCRIPT_FUNCTION(change_value) {
+  SCRIPT_PARAM(Set*, set);
+  SCRIPT_PARAM(CardP, card);
+  SCRIPT_PARAM(String, field);
+  SCRIPT_PARAM_C(String, value);
+  IndexMap<FieldP,ValueP>::const_iterator value_it = card->data.find(field);
+  if (value_it == card->data.end()) {
+    throw ScriptError(format_string(_("Card doesn't have a field named '%s'"),field));
+  }
+  TextValueP text_value = dynamic_pointer_cast<TextValue>(*value_it);
+  if (!text_value) {
+    throw ScriptError(format_string(_("Can not set value '%s', it is not a text field"),field));
+  }
+  const String& old_value = text_value->value();
+  unique_ptr<TextValueAction> action = typing_action(text_value, 0, old_value.size(), 0, untag(old_value).size(), value, _("Change value"));
+  if (action) {
+    action->setCard(card);
+    set->actions.addAction(move(action));
+  }
+  return script_nil;
+}
+
+SCRIPT_FUNCTION(swap_cards) {
+  SCRIPT_PARAM(Set*, set);
+  SCRIPT_PARAM(int, first);
+  SCRIPT_PARAM(int, second);
+  if (first < 0 || second < 0 || (size_t)first >= set->cards.size() || (size_t)second >= set->cards.size()) {
+    throw ScriptError(_("Card position out of range"));
+  }
+  set->actions.addAction(make_unique<ReorderCardsAction>(*set, first, second));
+  return script_nil;
+}
+
+SCRIPT_FUNCTION(add_cards) {
+  SCRIPT_PARAM(Set*, set);
+  SCRIPT_PARAM_C(ScriptValueP, input);
+  vector<CardP> cards;
+  ScriptValueP it = input->makeIterator();
+  while (ScriptValueP item = it->next()) {
+    cards.push_back(from_script<CardP>(item));
+  }
+  if (!cards.empty()) {
+    set->actions.addAction(make_unique<AddCardAction>(ADD, *set, cards));
+  }
+  return script_nil;
+}
+
+// Perform the actions of a function as a single batch, as pasting and add cards scripts do
+SCRIPT_FUNCTION(action_batch) {
+  SCRIPT_PARAM(Set*, set);
+  SCRIPT_PARAM_C(ScriptValueP, input);
+  ActionBatch batch(set->actions);
+  return input->eval(ctx);
+}
+
+SCRIPT_FUNCTION(save_set) {
+  SCRIPT_PARAM(Set*, set);
+  set->save();
+  set->actions.setSavePoint();
+  return script_nil;
+}
+
+SCRIPT_FUNCTION(save_set_as) {
+  SCRIPT_PARAM(Set*, set);
+  SCRIPT_PARAM_C(String, input);
+  set->saveAs(input);
+  set->actions.setSavePoint();
+  return script_nil;
+}
+
+SCRIPT_FUNCTION(load_set) {
+  SCRIPT_PARAM_C(String, input);
+  SCRIPT_RETURN(import_set(input));
+}
+
+SCRIPT_FUNCTION(file_size) {
+  SCRIPT_PARAM_C(String, input);
+  wxULongLong size = wxFileName::GetSize(input);
+  if (size == wxInvalidSize) throw ScriptError(_("File not found: ") + input);
+  SCRIPT_RETURN((int)size.GetLo());
+}
+
+bool run_script_file(String const& filename, SetP const& set) {
   String contents = read_file(filename);
   // parse
   vector<ScriptParseError> errors;
@@ -87,9 +181,23 @@ bool run_script_file(String const& filename) {
     return false;
   }
   // run
-  Context ctx;
-  init_script_functions(ctx);
-  ScriptValueP result = ctx.eval(*script, false);
+  if (set) {
+    Context& ctx = set->getContext();
+    LocalScope scope(ctx);
+    ctx.setVariable(_("change_value"), script_change_value);
+    ctx.setVariable(_("swap_cards"),   script_swap_cards);
+    ctx.setVariable(_("add_cards"),    script_add_cards);
+    ctx.setVariable(_("action_batch"), script_action_batch);
+    ctx.setVariable(_("save_set"),     script_save_set);
+    ctx.setVariable(_("save_set_as"),  script_save_set_as);
+    ctx.setVariable(_("load_set"),     script_load_set);
+    ctx.setVariable(_("file_size"),    script_file_size);
+    ctx.eval(*script, false);
+  } else {
+    Context ctx;
+    init_script_functions(ctx);
+    ctx.eval(*script, false);
+  }
   // ignore result
   return true;
 }
@@ -136,6 +244,9 @@ void CLISetInterface::showUsage() {
   cli << _("   :pwd                Print the current working directory.\n");
   cli << _("   :cd                 Change the working directory.\n");
   cli << _("   :! <command>        Perform a shell command.\n");
+  cli << _("   :trace start        Start recording the time spent in rendering, scripts, etc.\n");
+  cli << _("   :trace stop         Stop recording.\n");
+  cli << _("   :trace save <file>  Write the recorded trace to a file, in Chrome trace format.\n");
   cli << _("\n Commands can be abreviated to their first letter if there is no ambiguity.\n\n");
 }
 
@@ -202,6 +313,17 @@ void CLISetInterface::handleCommand(const String& command) {
             system(arg.c_str());
           #endif
         }
+      } else if (before == _(":trace")) {
+        if (arg == _("start")) {
+          trace_start();
+        } else if (arg == _("stop")) {
+          trace_stop();
+        } else if (starts_with(arg, _("save "))) {
+          trace_save(arg.substr(5));
+          cli << trace_event_count() << _(" events written\n");
+        } else {
+          cli.show_message(MESSAGE_ERROR,_("Usage: :trace start|stop|save <file>"));
+        }
       #if USE_SCRIPT_PROFILING
         } else if (before == _(":profile")) {
           if (arg == _("full")) {
@@ -45,5 +45,7 @@ private:
   void setExportInfoCwd();
 };
 
-bool run_script_file(String const& filename);
+/// Run a script file, in the context of the set if one is given
+/** Returns false if the script could not be parsed */
+bool run_script_file(String const& filename, SetP const& set = SetP());
 
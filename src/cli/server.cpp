@@ -0,0 +1,190 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <util/error.hpp>
+#include <cli/server.hpp>
+#include <cli/text_io_handler.hpp>
+#include <data/set.hpp>
+#include <data/format/formats.hpp>
+#include <script/json.hpp>
+#include <script/parser.hpp>
+#include <script/context.hpp>
+#include <script/to_value.hpp>
+#include <script/functions/functions.hpp>
+
+ScriptValueP export_set(SetP const& set, vector<CardP> const& cards, ExportTemplateP const& exp, String const& outname);
+
+// ----------------------------------------------------------------------------- : Request parameters
+
+/// Get a parameter of a request, returns nullptr if it is not given
+ScriptValueP request_param(const ScriptValueP& request, const Char* name) {
+  const ScriptCustomCollection* col = dynamic_cast<const ScriptCustomCollection*>(request.get());
+  if (!col) return ScriptValueP();
+  auto it = col->key_value.find(name);
+  if (it == col->key_value.end() || it->second == script_nil) return ScriptValueP();
+  return it->second;
+}
+
+/// Get a string parameter of a request, throws if it is not given
+String required_param(const ScriptValueP& request, const Char* name) {
+  ScriptValueP value = request_param(request, name);
+  if (!value) throw Error(String(_("Missing parameter: ")) + name);
+  return value->toString();
+}
+
+/// Get the card selected by the "card" parameter, or nullptr if there is none
+CardP request_card(const Set& set, const ScriptValueP& request) {
+  ScriptValueP index = request_param(request, _("card"));
+  if (!index) return CardP();
+  int i = index->toInt();
+  if (i < 0 || (size_t)i >= set.cards.size()) {
+    throw Error(String::Format(_("Card index %d out of range, the set has %d cards"), i, (int)set.cards.size()));
+  }
+  return set.cards[i];
+}
+
+// ----------------------------------------------------------------------------- : ScriptServer
+
+ScriptServer::ScriptServer()
+  : scripts(MAX_SCRIPTS)
+  , running(false)
+{
+  // read and write files relative to the current directory, like the command line interface
+  ei.allow_writes_outside = true;
+  ei.directory_relative = ei.directory_absolute = wxGetCwd();
+  ei.export_template = make_intrusive<Package>();
+  ei.export_template->open(ei.directory_absolute, true);
+}
+
+ScriptServer::~ScriptServer() {}
+
+void ScriptServer::run() {
+  if (!cli.haveConsole()) {
+    throw Error(_("Can not run the server without a console;\nstart MSE with \"mse.com --server\""));
+  }
+  // errors are reported in the responses, not written to the output
+  bool old_write_errors_to_cli = write_errors_to_cli;
+  write_errors_to_cli = false;
+  running = true;
+  while (running) {
+    String request = cli.getLine();
+    if (request.empty() && !cli.canGetLine()) break;
+    if (trim(request).empty()) continue;
+    cli << handleRequest(request) << ENDL;
+    cli.flush();
+  }
+  write_errors_to_cli = old_write_errors_to_cli;
+}
+
+String ScriptServer::handleRequest(const String& request_text) {
+  ScriptValueP id;
+  String response;
+  try {
+    ScriptValueP request = json_to_script(request_text);
+    id = request_param(request, _("id"));
+    ScriptValueP result = handleCommand(required_param(request, _("command")), request);
+    response = _("\"ok\":true,\"result\":") + script_to_json(result ? result : script_nil);
+  } catch (const Error& e) {
+    response = _("\"ok\":false,\"error\":");
+    json_quote(response, e.what());
+  }
+  // warnings and errors that were not thrown
+  vector<String> messages;
+  MessageType type;
+  String message;
+  while (get_queued_message(type, message)) messages.push_back(message);
+  if (!messages.empty()) {
+    // the queue gives the last message first
+    response += _(",\"messages\":[");
+    for (size_t i = messages.size() ; i > 0 ; --i) {
+      json_quote(response, messages[i - 1]);
+      if (i > 1) response += _(',');
+    }
+    response += _("]");
+  }
+  return _("{\"id\":") + script_to_json(id ? id : script_nil) + _(",") + response + _("}");
+}
+
+ScriptValueP ScriptServer::handleCommand(const String& command, const ScriptValueP& request) {
+  if (command == _("load")) {
+    String name = required_param(request, _("set"));
+    SetP set = import_set(required_param(request, _("file")));
+    LoadedSet& loaded = sets[name];
+    loaded.set = set;
+    loaded.renderer.reset();
+    return to_script((int)set->cards.size());
+  } else if (command == _("unload")) {
+    if (!sets.erase(required_param(request, _("set")))) {
+      throw Error(_("No set loaded with that name"));
+    }
+    return ScriptValueP();
+  } else if (command == _("sets")) {
+    ScriptCustomCollectionP names = make_intrusive<ScriptCustomCollection>();
+    FOR_EACH(s, sets) names->value.push_back(to_script(s.first));
+    return names;
+  } else if (command == _("eval")) {
+    ScriptP script = getScript(required_param(request, _("script")));
+    // context
+    SetP set;
+    CardP card;
+    if (request_param(request, _("set"))) {
+      set = getSet(request).set;
+      card = request_card(*set, request);
+    }
+    if (!set && !our_context) {
+      our_context = make_unique<Context>();
+      init_script_functions(*our_context);
+    }
+    Context& ctx = card ? set->getContext(card) : set ? set->getContext() : *our_context;
+    ei.set = set;
+    WITH_DYNAMIC_ARG(export_info, &ei);
+    LocalScope scope(ctx);
+    ScriptCustomCollection* variables = dynamic_cast<ScriptCustomCollection*>(request_param(request, _("variables")).get());
+    if (variables) {
+      FOR_EACH(v, variables->key_value) ctx.setVariable(v.first, v.second);
+    }
+    return ctx.eval(*script, false);
+  } else if (command == _("render")) {
+    LoadedSet& loaded = getSet(request);
+    CardP card = request_card(*loaded.set, request);
+    if (!card) throw Error(_("Missing parameter: card"));
+    String filename = required_param(request, _("file"));
+    if (!loaded.renderer) loaded.renderer = make_unique<CardImageRenderer>(loaded.set);
+    if (!loaded.renderer->render(card).SaveFile(filename)) {
+      throw Error(_("Unable to write image: ") + filename);
+    }
+    return to_script(filename);
+  } else if (command == _("export")) {
+    LoadedSet& loaded = getSet(request);
+    ExportTemplateP exp = ExportTemplate::byName(required_param(request, _("template")));
+    ScriptValueP filename = request_param(request, _("file"));
+    ScriptValueP result = export_set(loaded.set, loaded.set->cards, exp, filename ? filename->toString() : String());
+    return filename ? filename : result;
+  } else if (command == _("quit")) {
+    running = false;
+    return ScriptValueP();
+  } else {
+    throw Error(_("Unknown command: ") + command);
+  }
+}
+
+ScriptServer::LoadedSet& ScriptServer::getSet(const ScriptValueP& request) {
+  String name = required_param(request, _("set"));
+  auto it = sets.find(name);
+  if (it == sets.end()) throw Error(_("No set loaded with the name: ") + name);
+  return it->second;
+}
+
+ScriptP ScriptServer::getScript(const String& code) {
+  ScriptP script;
+  if (scripts.find(code, script)) return script;
+  script = parse(code, nullptr, false);
+  scripts.store(code, script);
+  return script;
+}
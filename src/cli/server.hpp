@@ -0,0 +1,74 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#pragma once
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <data/export_template.hpp>
+#include <util/lru_cache.hpp>
+
+DECLARE_POINTER_TYPE(Set);
+DECLARE_POINTER_TYPE(Script);
+DECLARE_POINTER_TYPE(ScriptValue);
+class Context;
+class CardImageRenderer;
+
+// ----------------------------------------------------------------------------- : Script server
+
+/// Performs requests from other programs, for the --server command line option
+/** Requests are read from stdin, one JSON object per line, and for each request
+ *  a JSON object is written to stdout on a single line. Requests are handled in order,
+ *  so a client can send many requests without waiting for the responses.
+ *  The response has the same "id" as the request.
+ *
+ *  Unlike the command line interface the server keeps multiple sets loaded, by name,
+ *  and it keeps parsed scripts, so repeated requests don't pay for loading or parsing.
+ *
+ *  Requests have the form {"id":ID, "command":COMMAND, ...}, with commands:
+ *    - load:   {"set":NAME, "file":FILE}                load a set under a name
+ *    - unload: {"set":NAME}                             forget a loaded set
+ *    - sets:   {}                                       names of the loaded sets
+ *    - eval:   {"script":CODE, "set":NAME, "card":N, "variables":{...}}
+ *                                                       evaluate a script, set, card and variables are optional
+ *    - render: {"set":NAME, "card":N, "file":FILE}      write the image of a card
+ *    - export: {"set":NAME, "template":NAME, "file":FILE}
+ *                                                       export with an export template, without a file the result is returned
+ *    - quit:   {}                                       stop the server
+ *
+ *  Responses are {"id":ID, "ok":true, "result":...} or {"id":ID, "ok":false, "error":MESSAGE},
+ *  with a "messages" list of any warnings.
+ */
+class ScriptServer {
+public:
+  ScriptServer();
+  ~ScriptServer();
+
+  /// Handle requests until the end of the input, or a quit request
+  void run();
+  /// Handle a single request, returns the response
+  String handleRequest(const String& request);
+
+private:
+  /// A loaded set
+  struct LoadedSet {
+    SetP set;
+    unique_ptr<CardImageRenderer> renderer; ///< Created when a card is first rendered
+  };
+  map<String,LoadedSet>  sets;       ///< Loaded sets, by name
+  LruCache<String,ScriptP> scripts;  ///< Parsed scripts, by code, the most recently used are kept
+  unique_ptr<Context>    our_context; ///< Context for scripts that don't use a set
+  ExportInfo             ei;          ///< Allow scripts to write files in the working directory
+  bool                   running;
+
+  /// Maximum number of parsed scripts to keep
+  static const size_t MAX_SCRIPTS = 10000;
+
+  ScriptValueP handleCommand(const String& command, const ScriptValueP& request);
+  LoadedSet& getSet(const ScriptValueP& request);
+  ScriptP getScript(const String& code);
+};
@@ -55,7 +55,7 @@ void TextIOHandler::init() {
     have_console = false;
     have_stderr = false;
     // Use console mode if one of the cli flags is passed
-    static const Char* redirect_flags[] = {_("-?"),_("--help"),_("-v"),_("--version"),_("--cli"),_("-c"),_("--export"),_("--create-installer")};
+    static const Char* redirect_flags[] = {_("-?"),_("--help"),_("-v"),_("--version"),_("--cli"),_("-c"),_("--export"),_("--create-installer"),_("--bench"),_("--server")};
     for (int i = 1 ; i < wxTheApp->argc ; ++i) {
       for (size_t j = 0 ; j < sizeof(redirect_flags)/sizeof(redirect_flags[0]) ; ++j) {
         if (String(wxTheApp->argv[i]) == redirect_flags[j]) {
@@ -86,7 +86,7 @@ bool TextIOHandler::haveConsole() const {
 TextIOHandler& TextIOHandler::operator << (const Char* str) {
   if ((escapes && !raw_mode) || str[0] != 27) {
     if (have_console && !raw_mode) {
-      IF_UNICODE(fwprintf,fprintf)(stream,str);
+      IF_UNICODE(fputws,fputs)(str,stream);
     } else {
       buffer += str;
     }
@@ -55,10 +55,7 @@ void ReorderCardsAction::perform(bool to_undo) {
     assert(card_id1 < set.cards.size());
     assert(card_id2 < set.cards.size());
   #endif
-  if (card_id1 >= set.cards.size() || card_id2 < set.cards.size()) {
-    // TODO : Too lazy to fix this right now.
-    return;
-  }
+  if (card_id1 >= set.cards.size() || card_id2 >= set.cards.size()) return;
   swap(set.cards[card_id1], set.cards[card_id2]);
 }
 
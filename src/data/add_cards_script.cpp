@@ -41,6 +41,8 @@ void AddCardsScript::perform(Set& set, vector<CardP>& out) {
 }
 
 void AddCardsScript::perform(Set& set) {
+  // the scripts that depend on the card list are updated once, at the end
+  ActionBatch batch(set.actions);
   // Perform script
   vector<CardP> cards;
   perform(set,cards);
@@ -60,6 +60,13 @@ bool Card::contains(QuickFilterPart const& query) const {
   return false;
 }
 
+void Card::getSearchText(vector<pair<String,String>>& out) const {
+  FOR_EACH_CONST(v, data) {
+    out.emplace_back(v->fieldP->name, v->toString());
+  }
+  out.emplace_back(_("notes"), notes);
+}
+
 IndexMap<FieldP, ValueP>& Card::extraDataFor(const StyleSheet& stylesheet) {
   return extra_data.get(stylesheet.name(), stylesheet.extra_card_fields);
 }
@@ -63,6 +63,8 @@ public:
   String identification() const;
   /// Does any field contains the given query string?
   bool contains(QuickFilterPart const& query) const;
+  /// The text that is searched by contains, for QuickSearchIndex
+  void getSearchText(vector<pair<String,String>>& out) const;
   
   /// Find a value in the data by name and type
   template <typename T> T& value(const String& name) {
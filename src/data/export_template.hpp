@@ -18,6 +18,7 @@ DECLARE_POINTER_TYPE(Field);
 DECLARE_POINTER_TYPE(Style);
 DECLARE_POINTER_TYPE(ExportTemplate);
 DECLARE_POINTER_TYPE(Package);
+class CardImageRenderer;
 
 // ----------------------------------------------------------------------------- : ExportTemplate
 
@@ -57,6 +58,7 @@ struct ExportInfo {
   String             directory_absolute; ///< The absolute path of the directory
   map<String,wxSize> exported_images;     ///< Images (from symbol font) already exported, and their size
   bool               allow_writes_outside; ///< Can files outside the directory be written to?
+  shared_ptr<CardImageRenderer> card_renderer; ///< Renderer for card images, created when first needed
 };
 
 DECLARE_DYNAMIC_ARG(ExportInfo*, export_info);
@@ -33,6 +33,7 @@ Field::Field()
   , card_list_visible(false)
   , card_list_allow  (true)
   , card_list_align  (ALIGN_LEFT)
+  , update_order     (0)
 {}
 
 Field::~Field() {}
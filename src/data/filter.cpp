@@ -8,6 +8,7 @@
 
 #include <util/prec.hpp>
 #include <data/filter.hpp>
+#include <unordered_set>
 
 // ----------------------------------------------------------------------------- : Quick filter
 
@@ -39,4 +40,125 @@ vector<QuickFilterPart> parse_quicksearch_query(String const& query) {
     parts.push_back(part);
   }
   return parts;
-}
\ No newline at end of file
+}
+
+
+// ----------------------------------------------------------------------------- : Quick search index
+
+/// Minimum number of dead ids before the index is rebuilt
+const size_t MIN_DEAD_IDS = 1000;
+
+/// Lower case version of a string, the same as comparing with is_substr_i
+String to_lower_chars(String const& str) {
+  String out;
+  out.reserve(str.size());
+  for (wxUniChar c : str) out += toLower(c);
+  return out;
+}
+
+/// Add the trigrams in a string to a list
+void add_trigrams(String const& str, vector<uint64_t>& out) {
+  uint64_t trigram = 0;
+  size_t count = 0;
+  for (wxUniChar c : str) {
+    // unicode code points fit in 21 bits
+    trigram = ((trigram << 21) | (c.GetValue() & 0x1FFFFF)) & ((uint64_t(1) << 63) - 1);
+    if (++count >= 3) out.push_back(trigram);
+  }
+}
+
+QuickSearchIndex::QuickSearchIndex()
+  : dead_ids(0)
+{}
+
+void QuickSearchIndex::clear() {
+  entries.clear();
+  items_by_id.clear();
+  postings.clear();
+  dead_ids = 0;
+}
+
+void QuickSearchIndex::changed(Item item) {
+  auto it = entries.find(item);
+  if (it == entries.end()) return;
+  items_by_id[it->second.id] = nullptr;
+  entries.erase(it);
+  dead_ids++;
+  // the posting lists still contain the old ids, start over if they are mostly dead
+  if (dead_ids >= MIN_DEAD_IDS && dead_ids > entries.size()) {
+    clear();
+  }
+}
+
+void QuickSearchIndex::add(Item item, Fields& fields) {
+  Entry& entry = entries[item];
+  entry.id = items_by_id.size();
+  items_by_id.push_back(item);
+  vector<uint64_t> trigrams;
+  FOR_EACH(f, fields) {
+    f.second = to_lower_chars(f.second);
+    add_trigrams(f.second, trigrams);
+  }
+  sort(trigrams.begin(), trigrams.end());
+  trigrams.erase(unique(trigrams.begin(), trigrams.end()), trigrams.end());
+  FOR_EACH(t, trigrams) {
+    postings[t].push_back(entry.id); // ids are increasing, so the lists stay sorted
+  }
+  swap(entry.fields, fields);
+}
+
+/// Does an entry match a part of a query?
+bool match_entry(QuickSearchIndex::Fields const& fields, String const& type, String const& lower_query) {
+  FOR_EACH_CONST(f, fields) {
+    if ((type.empty() || find_i(f.first, type) != String::npos) && f.second.find(lower_query) != String::npos) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void QuickSearchIndex::select(vector<Item> const& items, vector<QuickFilterPart> const& query, vector<bool>& keep) const {
+  keep.assign(items.size(), true);
+  FOR_EACH_CONST(part, query) {
+    String lower_query = to_lower_chars(part.query);
+    vector<uint64_t> trigrams;
+    add_trigrams(lower_query, trigrams);
+    if (trigrams.empty()) {
+      // too short to use the index, but we can still use the stored text
+      for (size_t i = 0 ; i < items.size() ; ++i) {
+        if (!keep[i]) continue;
+        const Entry& entry = entries.find(items[i])->second;
+        if (match_entry(entry.fields, part.type, lower_query) != part.need_match) keep[i] = false;
+      }
+      continue;
+    }
+    // find ids that contain all trigrams, starting with the rarest
+    vector<const vector<size_t>*> lists;
+    bool none = false;
+    FOR_EACH(t, trigrams) {
+      auto it = postings.find(t);
+      if (it == postings.end()) { none = true; break; }
+      lists.push_back(&it->second);
+    }
+    unordered_set<Item> matches; // only candidates can match
+    if (!none) {
+      sort(lists.begin(), lists.end(), [](const vector<size_t>* a, const vector<size_t>* b) { return a->size() < b->size(); });
+      vector<size_t> ids = *lists.front();
+      for (size_t j = 1 ; j < lists.size() && !ids.empty() ; ++j) {
+        vector<size_t> both;
+        set_intersection(ids.begin(), ids.end(), lists[j]->begin(), lists[j]->end(), back_inserter(both));
+        swap(ids, both);
+      }
+      // check the candidates
+      FOR_EACH(id, ids) {
+        Item item = items_by_id[id];
+        if (!item) continue; // item has changed since
+        const Entry& entry = entries.find(item)->second;
+        if (match_entry(entry.fields, part.type, lower_query)) matches.insert(item);
+      }
+    }
+    for (size_t i = 0 ; i < items.size() ; ++i) {
+      if (keep[i] && (matches.find(items[i]) != matches.end()) != part.need_match) keep[i] = false;
+    }
+  }
+}
@@ -9,6 +9,9 @@
 // ----------------------------------------------------------------------------- : Includes
 
 #include <util/prec.hpp>
+#include <unordered_map>
+
+DECLARE_POINTER_TYPE(QuickSearchIndex);
 
 // ----------------------------------------------------------------------------- : Filters
 
@@ -59,15 +62,86 @@ bool match_quicksearch_query(vector<QuickFilterPart> const& query, T const& obje
   return true;
 }
 
+// ----------------------------------------------------------------------------- : Quick search index
+
+/// An index of the text of objects, for answering quick search queries without looking at all the text
+/** For each object the lower case text of its fields is stored, as returned by getSearchText,
+ *  so it doesn't have to be recomputed for every query.
+ *  A query part of at least three characters is only checked against the objects that contain all its trigrams.
+ *
+ *  Objects are added to the index when they are first searched.
+ *  The owner of the index must call changed() when the text of an object changes, or when it is deleted.
+ *  Should only be used from the main thread.
+ */
+class QuickSearchIndex : public IntrusivePtrBase<QuickSearchIndex> {
+public:
+  typedef const void* Item;
+  /// The searchable text of an object, as pairs of field name and text
+  typedef vector<pair<String,String>> Fields;
+  
+  QuickSearchIndex();
+  
+  /// The text of an item has changed, it will be indexed again
+  void changed(Item item);
+  /// Forget all items
+  void clear();
+  
+  /// Select the objects that match a query, in the same order
+  template <typename T>
+  void getItems(vector<intrusive_ptr<T>> const& in, vector<QuickFilterPart> const& query, vector<VoidP>& out) {
+    vector<Item> items;
+    items.reserve(in.size());
+    for (auto const& x : in) {
+      if (entries.find(x.get()) == entries.end()) {
+        Fields fields;
+        x->getSearchText(fields);
+        add(x.get(), fields);
+      }
+      items.push_back(x.get());
+    }
+    vector<bool> keep;
+    select(items, query, keep);
+    for (size_t i = 0 ; i < in.size() ; ++i) {
+      if (keep[i]) out.push_back(in[i]);
+    }
+  }
+  
+private:
+  struct Entry {
+    size_t id;     ///< Id of the item in the posting lists
+    Fields fields; ///< The text of the item, in lower case
+  };
+  unordered_map<Item,Entry>           entries;
+  vector<Item>                        items_by_id; ///< nullptr for ids of items that have changed
+  size_t                              dead_ids;    ///< Number of nullptrs in items_by_id
+  unordered_map<uint64_t,vector<size_t>> postings; ///< Sorted ids of the items that contain each trigram
+  
+  void add(Item item, Fields& fields);
+  /// For each item, does it match all parts of the query? All items must be in the index
+  void select(vector<Item> const& items, vector<QuickFilterPart> const& query, vector<bool>& keep) const;
+};
+
 /// A filter function that searches for objects containing a string
+/** If an index is given it is used to find the objects, in that case T must have a getSearchText function.
+ */
 template <typename T>
 class QuickFilter : public Filter<T> {
 public:
-  QuickFilter(String const& query) : query(parse_quicksearch_query(query)) {}
+  QuickFilter(String const& query, QuickSearchIndexP const& index = QuickSearchIndexP())
+    : query(parse_quicksearch_query(query)), index(index)
+  {}
   bool keep(T const& x) const override {
     return match_quicksearch_query(query, x);
   }
+  void getItems(vector<intrusive_ptr<T>> const& in, vector<VoidP>& out) const override {
+    if (index) {
+      index->getItems(in, query, out);
+    } else {
+      Filter<T>::getItems(in, out);
+    }
+  }
 private:
   vector<QuickFilterPart> query;
+  QuickSearchIndexP       index;
 };
 
@@ -92,8 +92,11 @@ FileFormatP mtg_editor_file_format();
 void export_images(Window* parent, const SetP& set);
 
 /// Export the image for each card in a list of cards
+/** If jobs > 1, the images are encoded and written to disk using that many worker threads.
+ *  Rendering is always done on the main thread.
+ */
 void export_images(const SetP& set, const vector<CardP>& cards,
-                   const String& path, const String& filename_template, FilenameConflicts conflicts);
+                   const String& path, const String& filename_template, FilenameConflicts conflicts, int jobs = 1);
 
 /// Export the image of a single card
 void export_image(const SetP& set, const CardP& card, const String& filename);
@@ -101,6 +104,34 @@ void export_image(const SetP& set, const CardP& card, const String& filename);
 /// Generate a bitmap image of a card
 Bitmap export_bitmap(const SetP& set, const CardP& card);
 
+class UnzoomedDataViewer;
+
+/// Renders images of the cards in a set, for exporting
+/** The viewer and the drawing buffer are reused between cards.
+ *  So when exporting many cards with the same stylesheet, the value viewers (and their caches)
+ *  are only created once, instead of once per card.
+ *
+ *  TODO : drawing still goes through a wxMemoryDC and ConvertToImage, so exporting needs a display.
+ *         Drawing directly into an Image, without a DC, is not done yet.
+ */
+class CardImageRenderer {
+public:
+  CardImageRenderer(const SetP& set);
+  ~CardImageRenderer();
+  
+  /// Render the image of a card
+  Image render(const CardP& card);
+  
+private:
+  SetP set;
+  unique_ptr<UnzoomedDataViewer> viewer;
+  Bitmap buffer; ///< Bitmap that is drawn to, reused if the card size doesn't change
+  
+  /// Draw a card to the buffer
+  void draw(const CardP& card);
+  friend Bitmap export_bitmap(const SetP& set, const CardP& card);
+};
+
 /// Export a set to Magic Workstation format
 void export_mws(Window* parent, const SetP& set);
 
@@ -15,23 +15,33 @@
 #include <data/settings.hpp>
 #include <render/card/viewer.hpp>
 #include <wx/filename.h>
+#include <wx/thread.h>
+#include <deque>
 
 // ----------------------------------------------------------------------------- : Single card export
 
 void export_image(const SetP& set, const CardP& card, const String& filename) {
-  Image img = export_bitmap(set, card).ConvertToImage();
+  Image img = CardImageRenderer(set).render(card);
   img.SaveFile(filename);  // can't use Bitmap::saveFile, it wants to know the file type
               // but image.saveFile determines it automagicly
 }
 
+Bitmap export_bitmap(const SetP& set, const CardP& card) {
+  CardImageRenderer renderer(set);
+  renderer.draw(card);
+  return renderer.buffer;
+}
+
+// ----------------------------------------------------------------------------- : CardImageRenderer
+
 class UnzoomedDataViewer : public DataViewer {
 public:
-  UnzoomedDataViewer(bool use_zoom_settings)
+  UnzoomedDataViewer(bool use_zoom_settings = false)
     : use_zoom_settings(use_zoom_settings)
   {}
   Rotation getRotation() const override;
-private:
   bool use_zoom_settings;
+private:
   double zoom  = 1.0;
   double angle = 0.0;
 };
@@ -44,38 +54,155 @@ Rotation UnzoomedDataViewer::getRotation() const {
   }
 }
 
-Bitmap export_bitmap(const SetP& set, const CardP& card) {
+CardImageRenderer::CardImageRenderer(const SetP& set)
+  : set(set)
+  , viewer(make_unique<UnzoomedDataViewer>())
+{
   if (!set) throw Error(_("no set"));
-  // create viewer
-  UnzoomedDataViewer viewer(!settings.stylesheetSettingsFor(set->stylesheetFor(card)).card_normal_export());
-  viewer.setSet(set);
-  viewer.setCard(card);
+  viewer->setSet(set);
+}
+
+CardImageRenderer::~CardImageRenderer() {}
+
+Image CardImageRenderer::render(const CardP& card) {
+  draw(card);
+  return buffer.ConvertToImage();
+}
+
+void CardImageRenderer::draw(const CardP& card) {
+  viewer->use_zoom_settings = !settings.stylesheetSettingsFor(set->stylesheetFor(card)).card_normal_export();
+  viewer->setCard(card);
   // size of cards
-  RealSize size = viewer.getRotation().getExternalSize();
-  // create bitmap & dc
-  Bitmap bitmap((int) size.width, (int) size.height);
-  if (!bitmap.Ok()) throw InternalError(_("Unable to create bitmap"));
-  wxMemoryDC dc;
-  dc.SelectObject(bitmap);
+  RealSize size = viewer->getRotation().getExternalSize();
+  // (re)create bitmap, when the size changes
+  if (!buffer.Ok() || buffer.GetWidth() != (int)size.width || buffer.GetHeight() != (int)size.height) {
+    buffer = Bitmap((int) size.width, (int) size.height);
+    if (!buffer.Ok()) throw InternalError(_("Unable to create bitmap"));
+  }
   // draw
-  viewer.draw(dc);
+  wxMemoryDC dc;
+  dc.SelectObject(buffer);
+  viewer->draw(dc);
   dc.SelectObject(wxNullBitmap);
-  return bitmap;
 }
 
-// ----------------------------------------------------------------------------- : Multiple card export
+// ----------------------------------------------------------------------------- : Parallel saving
+
+/// A pool of worker threads that encode and write exported card images.
+/** Rendering must happen on the main thread, because it uses a DC and the set's script context.
+ *  Encoding the rendered image to png/jpg is independent for each card, and takes a large part of the time,
+ *  so that is what the workers do.
+ *
+ *  Images are only ever touched by one thread at a time: they are handed over while holding the mutex,
+ *  since the reference count of wxImage is not thread safe.
+ */
+class ImageSaveThreads {
+public:
+  ImageSaveThreads(int jobs);
+  /// Waits for all workers to finish
+  ~ImageSaveThreads();
+  
+  /// Queue an image to be written to a file.
+  /** The image is cleared, the caller should not share it with anyone else.
+   *  Blocks if too many images are waiting, to limit memory use.
+   */
+  void save(Image& img, const String& filename);
+  
+private:
+  class Worker;
+  wxMutex     mutex;
+  wxCondition changed;  ///< Signaled when the queue changes
+  deque<pair<Image,String>> queue; ///< Images waiting to be written
+  size_t          max_queue;
+  bool            finished; ///< No more images will be queued
+  vector<Worker*> workers;
+};
+
+class ImageSaveThreads::Worker : public wxThread {
+public:
+  Worker(ImageSaveThreads& parent) : wxThread(wxTHREAD_JOINABLE), parent(parent) {}
+  ExitCode Entry() override;
+private:
+  ImageSaveThreads& parent;
+};
+
+wxThread::ExitCode ImageSaveThreads::Worker::Entry() {
+  while (true) {
+    pair<Image,String> job;
+    {
+      wxMutexLocker lock(parent.mutex);
+      while (parent.queue.empty() && !parent.finished) {
+        parent.changed.Wait();
+      }
+      if (parent.queue.empty()) return 0;
+      job = parent.queue.front();
+      parent.queue.pop_front();
+      parent.changed.Broadcast();
+    }
+    job.first.SaveFile(job.second);
+    {
+      wxMutexLocker lock(parent.mutex);
+      job.first = Image(); // release while holding the lock
+    }
+  }
+}
+
+ImageSaveThreads::ImageSaveThreads(int jobs)
+  : changed(mutex)
+  , max_queue(2 * jobs)
+  , finished(false)
+{
+  for (int i = 0 ; i < jobs ; ++i) {
+    Worker* worker = new Worker(*this);
+    if (worker->Create() != wxTHREAD_NO_ERROR || worker->Run() != wxTHREAD_NO_ERROR) {
+      delete worker;
+      break;
+    }
+    workers.push_back(worker);
+  }
+  if (workers.empty()) throw InternalError(_("Unable to start image export threads"));
+}
+
+ImageSaveThreads::~ImageSaveThreads() {
+  {
+    wxMutexLocker lock(mutex);
+    finished = true;
+    changed.Broadcast();
+  }
+  FOR_EACH(worker, workers) {
+    worker->Wait();
+    delete worker;
+  }
+}
 
+void ImageSaveThreads::save(Image& img, const String& filename) {
+  wxMutexLocker lock(mutex);
+  while (queue.size() >= max_queue) {
+    changed.Wait();
+  }
+  queue.push_back(make_pair(img, filename));
+  img = Image(); // the queue is now the only owner
+  changed.Broadcast();
+}
+
+// ----------------------------------------------------------------------------- : Multiple card export
 
 void export_images(const SetP& set, const vector<CardP>& cards,
-                   const String& path, const String& filename_template, FilenameConflicts conflicts)
+                   const String& path, const String& filename_template, FilenameConflicts conflicts, int jobs)
 {
   wxBusyCursor busy;
   // Script
   ScriptP filename_script = parse(filename_template, nullptr, true);
   // Path
   wxFileName fn(path);
+  // Encoding and writing files can be done in parallel
+  unique_ptr<ImageSaveThreads> save_threads;
+  if (jobs > 1) save_threads = make_unique<ImageSaveThreads>(jobs);
+  // Render all cards with the same viewer
+  CardImageRenderer renderer(set);
   // Export
-  std::set<String> used; // for CONFLICT_NUMBER_OVERWRITE
+  // Note: filenames are resolved here in card order, so the result doesn't depend on the order of writing
+  std::set<String> used; // for CONFLICT_NUMBER_OVERWRITE, and for files not yet written
   FOR_EACH_CONST(card, cards) {
     // filename for this card
     Context& ctx = set->getContext(card);
@@ -88,6 +215,12 @@ void export_images(const SetP& set, const vector<CardP>& cards,
     // write image
     filename = fn.GetFullPath();
     used.insert(filename);
-    export_image(set, card, filename);
+    Image img = renderer.render(card);
+    if (save_threads) {
+      save_threads->save(img, filename);
+    } else {
+      img.SaveFile(filename);
+    }
   }
+  // destroying save_threads waits until all images are written
 }
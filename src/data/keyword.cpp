@@ -9,10 +9,8 @@
 #include <util/prec.hpp>
 #include <data/keyword.hpp>
 #include <util/tagged_string.hpp>
-#include <unordered_map>
-#include <unordered_set>
 
-class KeywordTrie;
+class KeywordMatcher;
 DECLARE_POINTER_TYPE(KeywordParamValue);
 class Value;
 DECLARE_DYNAMIC_ARG(Value*, value_being_updated);
@@ -83,6 +81,13 @@ bool Keyword::contains(QuickFilterPart const& query) const {
   return false;
 }
 
+void Keyword::getSearchText(vector<pair<String,String>>& out) const {
+  out.emplace_back(_("keyword"),  keyword);
+  out.emplace_back(_("rules"),    rules);
+  out.emplace_back(_("match"),    match);
+  out.emplace_back(_("reminder"), reminder.get());
+}
+
 IMPLEMENT_REFLECTION(Keyword) {
   REFLECT(keyword);
   if (handler.formatVersion() < 301) read_compat(handler, this);
@@ -208,100 +213,208 @@ void Keyword::prepare(const vector<KeywordParamP>& param_types, bool force) {
   valid = !match_re.matches(_(""));
 }
 
-// ----------------------------------------------------------------------------- : KeywordTrie
-
-namespace std {
-  template <> struct hash<wxUniChar> {
-    inline size_t operator () (wxUniChar x) const {
-      return std::hash<wxUniChar::value_type>()(x.GetValue());
-    }
-  };
-}
+// ----------------------------------------------------------------------------- : KeywordMatcher
 
-/// A node in a trie to match keywords
-/* The trie is used to speed up matching, by quickly finding candidate keywords.
-*/
-class KeywordTrie {
+/// Finds the keywords that can possibly match a string
+/** Matching a keyword's regex is expensive, so first we find the keywords that can match at all.
+ *  A keyword can only match if the literal text at the start of its match appears in the string,
+ *  so this is a multiple string search for the literal text of all keywords.
+ *
+ *  The search uses the Aho-Corasick algorithm: the literals are inserted in a trie,
+ *  which is then compiled into a deterministic automaton with a single flat transition table.
+ *  So matching takes a single table lookup per character, and it doesn't allocate memory.
+ *
+ *  To keep the table small, characters are mapped to classes first,
+ *  all characters that don't appear in any literal share class 0.
+ */
+class KeywordMatcher {
 public:
-  KeywordTrie();
-  ~KeywordTrie();
+  KeywordMatcher();
+  
+  /// Add a keyword, that possibly matches when the given literal text appears in a string
+  void insert(const String& literal, const Keyword& kw);
+  /// Build the transition table, this has to be done after inserting and before matching
+  void compile();
+  
+  /// Find the keywords that possibly match the given tagged string, tags are ignored.
+  /** Keywords are added to out in the order in which they are found. */
+  void possibleMatches(const String& tagged_str, vector<const Keyword*>& out) const;
   
-  unordered_map<wxUniChar, unique_ptr<KeywordTrie>> children; ///< children after a given character
-  KeywordTrie* on_any_star; ///< children on /.*/ (owned or this)
-  vector<const Keyword*> finished; ///< keywords that end in this node
+private:
+  // for building
+  vector<map<wxUniChar::value_type,unsigned>> children; ///< Trie edges of each state
+  vector<vector<unsigned>> state_keywords;              ///< Keywords whose literal ends in each state
+  set<wxUniChar::value_type> alphabet;                  ///< All characters in the literals
+  vector<const Keyword*> keywords;                      ///< All keywords, by index
+  vector<unsigned> always;                              ///< Keywords with an empty literal, these always possibly match
+  // the compiled automaton
+  unsigned class_count;                         ///< Number of character classes
+  unsigned ascii_classes[128];                  ///< Character class of ASCII characters
+  vector<wxUniChar::value_type> other_chars;    ///< Sorted non-ASCII characters in the alphabet, these have classes after the ASCII ones
+  unsigned other_first_class;                   ///< Class of other_chars[0]
+  vector<unsigned> transitions;                 ///< transitions[state * class_count + class] is the next state
+  vector<unsigned> output_begin;                ///< Keywords found in state s are outputs[output_begin[s] .. output_begin[s+1]]
+  vector<unsigned> outputs;
   
-  /// Insert nodes representing the given character
-  /** return the node where the evaluation will be after matching the character */
-  KeywordTrie* insert(wxUniChar match);
-  /// Insert nodes representing the given string
-  /** return the node where the evaluation will be after matching the string */
-  KeywordTrie* insert(const String& match);
-
-  /// Insert nodes representing the regex /.*/
-  /** return the node where the evaluation will be after matching that regex */
-  KeywordTrie* insertAnyStar();
+  inline unsigned charClass(wxUniChar::value_type c) const {
+    if (c < 128) return ascii_classes[c];
+    auto it = lower_bound(other_chars.begin(), other_chars.end(), c);
+    if (it == other_chars.end() || *it != c) return 0;
+    return other_first_class + (unsigned)(it - other_chars.begin());
+  }
 };
 
-
-KeywordTrie::KeywordTrie()
-  : on_any_star(nullptr)
-{}
-KeywordTrie::~KeywordTrie() {
-  if (on_any_star != this) delete on_any_star;
+KeywordMatcher::KeywordMatcher()
+  : children(1), state_keywords(1)
+  , class_count(1), other_first_class(1)
+{
+  fill(ascii_classes, ascii_classes + 128, 0);
 }
 
-KeywordTrie* KeywordTrie::insert(wxUniChar c) {
-  #if USE_CASE_INSENSITIVE_KEYWORDS
-    c = toLower(c); // case insensitive matching
-  #endif
-  unique_ptr<KeywordTrie>& child = children[c];
-  if (!child) child.reset(new KeywordTrie);
-  return child.get();
-}
-KeywordTrie* KeywordTrie::insert(const String& match) {
-  KeywordTrie* cur = this;
-  for (wxUniChar c : match) {
-    cur = cur->insert(c);
+void KeywordMatcher::insert(const String& literal, const Keyword& kw) {
+  unsigned kw_index = (unsigned)keywords.size();
+  keywords.push_back(&kw);
+  if (literal.empty()) {
+    always.push_back(kw_index);
+    return;
   }
-  return cur;
+  unsigned state = 0;
+  for (wxUniChar c : literal) {
+    #if USE_CASE_INSENSITIVE_KEYWORDS
+      c = toLower(c); // case insensitive matching
+    #endif
+    alphabet.insert(c.GetValue());
+    auto it = children[state].find(c.GetValue());
+    if (it != children[state].end()) {
+      state = it->second;
+    } else {
+      unsigned next = (unsigned)children.size();
+      children[state][c.GetValue()] = next;
+      children.emplace_back();
+      state_keywords.emplace_back();
+      state = next;
+    }
+  }
+  state_keywords[state].push_back(kw_index);
 }
 
-KeywordTrie* KeywordTrie::insertAnyStar() {
-  if (!on_any_star) on_any_star = new KeywordTrie();
-  on_any_star->on_any_star = on_any_star; // circular reference to itself
-  return on_any_star;
+void KeywordMatcher::compile() {
+  // character classes
+  fill(ascii_classes, ascii_classes + 128, 0);
+  other_chars.clear();
+  class_count = 1;
+  FOR_EACH(c, alphabet) {
+    if (c < 128) {
+      ascii_classes[c] = class_count++;
+    } else {
+      other_chars.push_back(c);
+    }
+  }
+  other_first_class = class_count;
+  class_count += (unsigned)other_chars.size();
+  // breadth first walk over the trie, so the failure state of a state is always done before the state itself
+  size_t state_count = children.size();
+  transitions.assign(state_count * class_count, 0);
+  vector<unsigned> failure(state_count, 0);
+  vector<vector<unsigned>> found(state_keywords); // keywords found in each state, including those of failure states
+  vector<unsigned> queue;
+  queue.reserve(state_count);
+  FOR_EACH(child, children[0]) {
+    transitions[charClass(child.first)] = child.second;
+    queue.push_back(child.second);
+  }
+  for (size_t i = 0 ; i < queue.size() ; ++i) {
+    unsigned state = queue[i];
+    const unsigned* fail_transitions = &transitions[failure[state] * class_count];
+    unsigned* state_transitions = &transitions[state * class_count];
+    copy(fail_transitions, fail_transitions + class_count, state_transitions);
+    FOR_EACH(child, children[state]) {
+      unsigned c = charClass(child.first);
+      failure[child.second] = fail_transitions[c];
+      const vector<unsigned>& fail_found = found[fail_transitions[c]];
+      found[child.second].insert(found[child.second].end(), fail_found.begin(), fail_found.end());
+      state_transitions[c] = child.second;
+      queue.push_back(child.second);
+    }
+  }
+  // flatten the output lists
+  output_begin.resize(state_count + 1);
+  outputs.clear();
+  for (size_t s = 0 ; s < state_count ; ++s) {
+    output_begin[s] = (unsigned)outputs.size();
+    outputs.insert(outputs.end(), found[s].begin(), found[s].end());
+  }
+  output_begin[state_count] = (unsigned)outputs.size();
 }
 
+void KeywordMatcher::possibleMatches(const String& tagged_str, vector<const Keyword*>& out) const {
+  vector<bool> seen(keywords.size(), false);
+  bool any_text = false;
+  unsigned state = 0;
+  for (String::const_iterator it = tagged_str.begin() ; it != tagged_str.end() ;) {
+    wxUniChar c = *it;
+    // tag?
+    if (c == '<') {
+      it = skip_tag(it, tagged_str.end());
+    } else {
+      ++it;
+      any_text = true;
+      c = toLower(c); // case insensitive matching
+      state = transitions[state * class_count + charClass(c.GetValue())];
+      for (unsigned i = output_begin[state] ; i < output_begin[state + 1] ; ++i) {
+        unsigned kw = outputs[i];
+        if (!seen[kw]) {
+          seen[kw] = true;
+          out.push_back(keywords[kw]);
+        }
+      }
+    }
+  }
+  if (any_text) {
+    for (unsigned kw : always) out.push_back(keywords[kw]);
+  }
+}
 
 // ----------------------------------------------------------------------------- : KeywordDatabase
 
 IMPLEMENT_DYNAMIC_ARG(KeywordUsageStatistics*, keyword_usage_statistics, nullptr);
 
 KeywordDatabase::KeywordDatabase()
-  : root(nullptr)
+  : matcher(nullptr)
+  , filled(false)
+  , memo(MAX_MEMO_SIZE)
 {}
-// Note: has to be here because in the header KeywordTrie is not defined
+// Note: has to be here because in the header KeywordMatcher is not defined
 KeywordDatabase::~KeywordDatabase() {}
 
 void KeywordDatabase::clear() {
-  root.reset();
+  // the matcher is read without a lock, the worker threads that do that only run while the main thread waits for them
+  assert(wxThread::IsMain());
+  matcher.reset();
+  filled = false;
+  memo.clear();
 }
 
 void KeywordDatabase::add(const vector<KeywordP>& kws) {
+  assert(wxThread::IsMain()); // see clear
   FOR_EACH_CONST(kw, kws) {
-    add(*kw);
+    insert(*kw);
   }
+  if (matcher) matcher->compile();
+  filled = true;
 }
 
 void KeywordDatabase::add(const Keyword& kw) {
+  assert(wxThread::IsMain()); // see clear
+  insert(kw);
+  if (matcher) matcher->compile();
+  filled = true;
+}
+
+void KeywordDatabase::insert(const Keyword& kw) {
   if (kw.match.empty() || !kw.valid) return; // can't handle empty keywords
-  // Create root
-  if (!root) {
-    root = make_unique<KeywordTrie>();
-    root->on_any_star = root.get();
-  }
-  KeywordTrie* cur = root->insertAnyStar();
-  // Add to trie
+  if (!matcher) matcher = make_unique<KeywordMatcher>();
+  // Find the literal text at the start of the keyword, parameters match anything
   String text; // normal text
   size_t param = 0;
   bool only_star = true;
@@ -315,16 +428,11 @@ void KeywordDatabase::add(const Keyword& kw) {
         kw.parameters[param]->eat_separator_after(kw.match, i);
       }
       ++param;
-      // match anything
-      cur = cur->insert(text);
-      text.clear();
-      cur = cur->insertAnyStar();
       // enough?
       if (!only_star) {
         // If we have matched anything specific, this is a good time to stop
-        // it doesn't really matter how long we go on, since the trie is only used
+        // it doesn't really matter how long we go on, since the matcher is only used
         // as an optimization to not have to match lots of regexes.
-        // As an added bonus, we get a better behaviour of matching earlier keywords first.
         break;
       }
     } else {
@@ -333,9 +441,7 @@ void KeywordDatabase::add(const Keyword& kw) {
       only_star = false;
     }
   }
-  cur = cur->insert(text);
-  // now cur is the trie after matching the keyword anywhere in the input text
-  cur->finished.push_back(&kw);
+  matcher->insert(text, kw);
 }
 
 void KeywordDatabase::prepare_parameters(const vector<KeywordParamP>& ps, const vector<KeywordP>& kws) {
@@ -344,77 +450,8 @@ void KeywordDatabase::prepare_parameters(const vector<KeywordParamP>& ps, const
   }
 }
 
-#ifdef _DEBUG
-void dump(int i, const KeywordTrie* t) {
-  FOR_EACH(c, t->children) {
-    wxLogDebug(String(i, _(' ')) + c.first + _("     ") + String::Format(_("%p"), c.second.get()));
-    dump(i + 2, c.second.get());
-  }
-  if (t->on_any_star) {
-    wxLogDebug(String(i, _(' ')) + _(".*") + _("     ") + String::Format(_("%p"), t->on_any_star));
-    if (t->on_any_star != t) dump(i + 2, t->on_any_star);
-  }
-}
-#endif
-
 // ----------------------------------------------------------------------------- : KeywordDatabase : matching
 
-// transitive closure of a state, follow all on_any_star links
-void closure(vector<const KeywordTrie*>& state) {
-  for (size_t j = 0 ; j < state.size() ; ++j) {
-    if (state[j]->on_any_star && state[j]->on_any_star != state[j]) {
-      state.push_back(state[j]->on_any_star);
-    }
-  }
-}
-
-void step_state(vector<const KeywordTrie*>& state, wxUniChar c) {
-  vector<const KeywordTrie*> next;
-  for(auto kt : state) {
-    auto it = kt->children.find(c);
-    if (it != kt->children.end()) {
-      next.push_back(it->second.get());
-    }
-    // TODO: on any star first or last?
-    if (kt->on_any_star) {
-      next.push_back(kt->on_any_star);
-    }
-  }
-  swap(state,next);
-}
-
-// Collect possible matching keywords
-/* First step in matching is to run over the string, and use the trie to find keywords that *potentially* appear in it.
- */
-unordered_set<Keyword const*> possible_matches(String const& tagged_str, KeywordTrie const* trie_root) {
-  unordered_set<const Keyword*> possible_matches;
-  if (!trie_root) return possible_matches;
-
-  vector<const KeywordTrie*> state;
-  state.push_back(trie_root);
-
-  for (String::const_iterator it = tagged_str.begin(); it != tagged_str.end();) {
-    wxUniChar c = *it;
-    // tag?
-    if (c == '<') {
-      it = skip_tag(it, tagged_str.end());
-    } else {
-      ++it;
-      c = toLower(c); // case insensitive matching
-      // find 'next' trie node set matching c
-      step_state(state, c);
-      closure(state);
-      // matches
-      for (auto kt : state) {
-        for (auto kw : kt->finished) {
-          possible_matches.insert(kw);
-        }
-      }
-    }
-  }
-  return possible_matches;
-}
-
 struct KeywordMatch {
   Keyword const* keyword;
   // match in (substring of) the untagged string
@@ -437,7 +474,7 @@ void keyword_matches(const String& untagged_str, const Keyword& keyword, vector<
     it = max(it+1, match[0].end());
   }
 }
-void keyword_matches(const String& untagged_str, unordered_set<Keyword const*> keywords, vector<KeywordMatch>& out) {
+void keyword_matches(const String& untagged_str, vector<Keyword const*> const& keywords, vector<KeywordMatch>& out) {
   for (auto keyword : keywords) {
     keyword_matches(untagged_str, *keyword, out);
   }
@@ -457,12 +494,14 @@ void sort_keyword_matches(vector<KeywordMatch>& matches) {
     return a.keyword->keyword < b.keyword->keyword;
   });
 }
-vector<KeywordMatch> keyword_matches(const String& untagged_str, unordered_set<Keyword const*> keywords) {
-  vector<KeywordMatch> out;
-  keyword_matches(untagged_str, keywords, out);
-  sort_keyword_matches(out);
-  return out;
-}
+
+/// The result of matching keywords in a text
+/** The matches refer to positions in untagged, so this should not be copied. */
+struct KeywordMatches {
+  String tagged;   ///< The text with old reminder texts removed
+  String untagged; ///< The untagged text
+  vector<KeywordMatch> matches; ///< Sorted matches
+};
 
 
 
@@ -778,25 +817,37 @@ String KeywordDatabase::expand(const String& text, KeywordExpandOptions const& o
   // Clean up usage statistics
   remove_from_stats(options.stat, options.stat_key);
   
-  // Remove all old reminder texts
-  String tagged = remove_keyword_tags(text);
-
   // any keywords in database?
-  if (!root) return tagged;
-
-  // Find potential matches
-  auto possible_matches = ::possible_matches(tagged, root.get());
+  if (!matcher) return remove_keyword_tags(text);
 
-  // Refine
-  String untagged = untag_no_escape(tagged);
-  auto matches = keyword_matches(untagged, possible_matches);
+  // Find matches
+  shared_ptr<const KeywordMatches> matches = findMatches(text);
   
   // Expand
-  String result = expand_keywords(tagged, matches, options);
+  String result = expand_keywords(matches->tagged, matches->matches, options);
   assert_tagged(result);
   return result;
 }
 
+shared_ptr<const KeywordMatches> KeywordDatabase::findMatches(const String& text) const {
+  shared_ptr<const KeywordMatches> found;
+  if (memo.find(text, found)) return found;
+  // another thread might match the same text at the same time, that only costs time
+  shared_ptr<KeywordMatches> result = make_shared<KeywordMatches>();
+  // Remove all old reminder texts
+  result->tagged = remove_keyword_tags(text);
+  // Find potential matches
+  vector<const Keyword*> possible_matches;
+  matcher->possibleMatches(result->tagged, possible_matches);
+  // Refine
+  result->untagged = untag_no_escape(result->tagged);
+  keyword_matches(result->untagged, possible_matches, result->matches);
+  sort_keyword_matches(result->matches);
+  // Remember
+  memo.store(text, result);
+  return result;
+}
+
 // ----------------------------------------------------------------------------- : KeywordParamValue
 
 ScriptType KeywordParamValue::type() const { return SCRIPT_STRING; }
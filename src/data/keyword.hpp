@@ -13,12 +13,14 @@
 #include <util/dynamic_arg.hpp>
 #include <util/regex.hpp>
 #include <data/filter.hpp>
+#include <util/lru_cache.hpp>
 
 DECLARE_POINTER_TYPE(KeywordParam);
 DECLARE_POINTER_TYPE(KeywordMode);
 DECLARE_POINTER_TYPE(Keyword);
 DECLARE_POINTER_TYPE(ParamReferenceType);
-class KeywordTrie;
+class KeywordMatcher;
+struct KeywordMatches;
 class Value;
 
 // ----------------------------------------------------------------------------- : Keyword parameters
@@ -118,6 +120,8 @@ public:
   
   /// Does the keyword contain the given query word?
   bool contains(QuickFilterPart const& query) const;
+  /// The text that is searched by contains, for QuickSearchIndex
+  void getSearchText(vector<pair<String,String>>& out) const;
   
   DECLARE_REFLECTION();
 };
@@ -146,6 +150,9 @@ struct KeywordExpandOptions {
 /// A database of keywords to allow for fast matching
 /** NOTE: keywords may not be altered after they are added to the database,
  *  The database should be rebuild.
+ *
+ *  expand can be called from multiple threads (see SetScriptManager::updateAllCards),
+ *  but the database is only changed (add and clear) on the main thread, while there are no such threads.
  */
 class KeywordDatabase {
 public:
@@ -162,8 +169,9 @@ public:
   
   /// Clear the database
   void clear();
-  /// Is the database empty?
-  inline bool empty() const { return !root; }
+  /// Is the database empty? That is, have no keywords been added since it was cleared?
+  /** Adding an empty list also counts, so a set without keywords doesn't have to build the database each time. */
+  inline bool empty() const { return !filled; }
   
   /// Expand/update all keywords in the given string.
   /** @param options.expand_default script function indicating whether reminder text should be shown by default
@@ -175,7 +183,23 @@ public:
   String expand(const String& text, const KeywordExpandOptions&) const;
   
 private:
-  unique_ptr<KeywordTrie> root; ///< Data structure for finding keywords
+  unique_ptr<KeywordMatcher> matcher; ///< Data structure for finding keywords, if there are any
+  bool filled;                        ///< Has add been called since the last clear?
+  
+  /// The keywords matching in each text that was expanded, by the text
+  /** Matching only depends on the text and the keywords, so it can be reused until the database is cleared.
+   *  Expanding the matches runs scripts that can look at the card and set, so that is not remembered.
+   *  Cards are updated on multiple threads, the memo does its own locking.
+   */
+  mutable LruCache<String, shared_ptr<const KeywordMatches>> memo;
+  /// Maximum number of texts in the memo, the least recently used are forgotten
+  static const size_t MAX_MEMO_SIZE = 10000;
+  
+  /// Find the keywords matching in a text, or reuse the result from the memo
+  shared_ptr<const KeywordMatches> findMatches(const String& text) const;
+  
+  /// Add a keyword to the matcher, without compiling it
+  void insert(const Keyword&);
   
   /// (try to) expand a single keyword
   /** If the keyword matches:
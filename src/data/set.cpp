@@ -16,6 +16,10 @@
 #include <data/field.hpp>
 #include <data/field/text.hpp>    // for 0.2.7 fix
 #include <data/field/information.hpp>
+#include <data/filter.hpp>
+#include <data/action/value.hpp>
+#include <data/action/set.hpp>
+#include <data/action/keyword.hpp>
 #include <util/tagged_string.hpp> // for 0.2.7 fix
 #include <util/order_cache.hpp>
 #include <util/delayed_index_maps.hpp>
@@ -23,17 +27,75 @@
 #include <script/profiler.hpp>
 #include <wx/sstream.h>
 
+// ----------------------------------------------------------------------------- : SetSearchIndexUpdater
+
+/// Tells the search indices of a set which cards and keywords have changed
+class SetSearchIndexUpdater : public ActionListener {
+public:
+  SetSearchIndexUpdater(Set& set) : set(set) {
+    set.actions.addListener(this);
+  }
+  ~SetSearchIndexUpdater() {
+    set.actions.removeListener(this);
+  }
+  
+  void onAction(const Action& action, bool undone) override {
+    TYPE_CASE(action, ValueAction) {
+      if (action.card) {
+        set.card_search_index->changed(action.card.get());
+        return;
+      }
+      KeywordTextValue* keyword_value = dynamic_cast<KeywordTextValue*>(action.valueP.get());
+      if (keyword_value) {
+        set.keyword_search_index->changed(&keyword_value->keyword);
+        return;
+      }
+      // the card notes are edited through a fake value
+      FakeTextValue* fake_value = dynamic_cast<FakeTextValue*>(action.valueP.get());
+      if (fake_value && fake_value->underlying) {
+        FOR_EACH(card, set.cards) {
+          if (&card->notes == fake_value->underlying) {
+            set.card_search_index->changed(card.get());
+          }
+        }
+      }
+    }
+    TYPE_CASE(action, ScriptValueEvent) {
+      if (action.card) set.card_search_index->changed(action.card);
+    }
+    TYPE_CASE(action, AddCardAction) {
+      FOR_EACH_CONST(step, action.action.steps) {
+        set.card_search_index->changed(step.item.get());
+      }
+    }
+    TYPE_CASE(action, AddKeywordAction) {
+      FOR_EACH_CONST(step, action.action.steps) {
+        set.keyword_search_index->changed(step.item.get());
+      }
+    }
+  }
+  
+private:
+  Set& set;
+};
+
 // ----------------------------------------------------------------------------- : Set
 
 Set::Set()
   : vcs (make_intrusive<VCS>())
+  , card_search_index   (make_intrusive<QuickSearchIndex>())
+  , keyword_search_index(make_intrusive<QuickSearchIndex>())
   , script_manager(new SetScriptManager(*this))
+  , search_index_updater(new SetSearchIndexUpdater(*this))
 {}
 
 Set::Set(const GameP& game)
   : game(game)
   , vcs (make_intrusive<VCS>())
+  , card_search_index   (make_intrusive<QuickSearchIndex>())
+  , keyword_search_index(make_intrusive<QuickSearchIndex>())
   , script_manager(new SetScriptManager(*this))
+  , search_index_updater(new SetSearchIndexUpdater(*this))
 {
   data.init(game->set_fields);
 }
@@ -42,7 +104,10 @@ Set::Set(const StyleSheetP& stylesheet)
   : game(stylesheet->game)
   , stylesheet(stylesheet)
   , vcs (make_intrusive<VCS>())
+  , card_search_index   (make_intrusive<QuickSearchIndex>())
+  , keyword_search_index(make_intrusive<QuickSearchIndex>())
   , script_manager(new SetScriptManager(*this))
+  , search_index_updater(new SetSearchIndexUpdater(*this))
 {
   data.init(game->set_fields);
 }
@@ -164,6 +229,9 @@ void Set::validate(Version file_app_version) {
   if (cards.empty()) cards.push_back(make_intrusive<Card>(*game));
   // update scripts
   script_manager->updateAll();
+  // values were changed without actions
+  card_search_index->clear();
+  keyword_search_index->clear();
 }
 
 void reflect_version_check(Reader& handler, const Char* key, intrusive_ptr<Packaged> const& package) {
@@ -274,9 +342,12 @@ void reflect_set_info_get_member(GetMember& handler, const IndexMap<FieldP, Valu
   REFLECT_NAMELESS(data);
 }
 
-int Set::positionOfCard(const CardP& card, const ScriptValueP& order_by, const ScriptValueP& filter) {
-  // TODO : Lock the map?
-  assert(order_by);
+OrderCache<CardP>& Set::orderCache(const ScriptValueP& order_by, const ScriptValueP& filter) {
+  // the caches are not locked, and the order scripts need the main thread contexts
+  // scripts using them are kept on the main thread by SetScriptManager::cardsAreIndependent, so this is only a safety net
+  if (!wxThread::IsMain()) {
+    throw ScriptError(_("The card order can only be determined on the main thread"));
+  }
   OrderCacheP& order = order_cache[make_pair(order_by,filter)];
   if (!order) {
     // 1. make a list of the order value for each card
@@ -284,7 +355,7 @@ int Set::positionOfCard(const CardP& card, const ScriptValueP& order_by, const S
     vector<int>    keep;   if(filter) keep.reserve(cards.size());
     FOR_EACH_CONST(c, cards) {
       Context& ctx = getContext(c);
-      values.push_back(order_by->eval(ctx)->toString());
+      values.push_back(order_by ? order_by->eval(ctx)->toString() : String());
       if (filter) {
         keep.push_back(filter->eval(ctx)->toBool());
       }
@@ -295,26 +366,53 @@ int Set::positionOfCard(const CardP& card, const ScriptValueP& order_by, const S
     #endif
     // 3. initialize order cache
     order = make_intrusive<OrderCache<CardP>>(cards, values, filter ? &keep : nullptr);
+  } else if (!order->invalidated().empty()) {
+    // re-evaluate only the cards that have changed
+    unordered_set<const Card*> in_set;
+    FOR_EACH_CONST(c, cards) in_set.insert(c.get());
+    FOR_EACH_CONST(c, order->invalidated()) {
+      if (in_set.count(c.get())) {
+        Context& ctx = getContext(c);
+        order->update(c, order_by ? order_by->eval(ctx)->toString() : String(),
+                         !filter || filter->eval(ctx)->toBool());
+      } else {
+        order->remove(c);
+      }
+    }
+    order->clearInvalidated();
   }
-  return order->find(card);
+  return *order;
+}
+
+int Set::positionOfCard(const CardP& card, const ScriptValueP& order_by, const ScriptValueP& filter) {
+  assert(order_by);
+  return orderCache(order_by, filter).find(card);
 }
 int Set::numberOfCards(const ScriptValueP& filter) {
   if (!filter) return (int)cards.size();
-  map<ScriptValueP,int>::const_iterator it = filter_cache.find(filter);
-  if (it !=filter_cache.end()) {
-    return it->second;
-  } else {
-    int n = 0;
-    FOR_EACH_CONST(c, cards) {
-      if (filter->eval(getContext(c))->toBool()) ++n;
-    }
-    filter_cache.insert(make_pair(filter,n));
-    return n;
-  }
+  return orderCache(ScriptValueP(), filter).count();
 }
 void Set::clearOrderCache() {
   order_cache.clear();
-  filter_cache.clear();
+}
+void Set::invalidateOrderCache(const CardP& card) {
+  if (!card) {
+    clearOrderCache();
+    return;
+  }
+  FOR_EACH(o, order_cache) {
+    o.second->invalidate(card);
+  }
+}
+
+KeywordDatabase& Set::keywordDatabase() {
+  if (keyword_db.empty()) {
+    keyword_db.prepare_parameters(game->keyword_parameter_types, keywords);
+    keyword_db.prepare_parameters(game->keyword_parameter_types, game->keywords);
+    keyword_db.add(keywords);
+    keyword_db.add(game->keywords);
+  }
+  return keyword_db;
 }
 
 // ----------------------------------------------------------------------------- : SetView
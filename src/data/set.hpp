@@ -25,7 +25,9 @@ DECLARE_POINTER_TYPE(Value);
 DECLARE_POINTER_TYPE(Keyword);
 DECLARE_POINTER_TYPE(PackType);
 DECLARE_POINTER_TYPE(ScriptValue);
+DECLARE_POINTER_TYPE(QuickSearchIndex);
 class SetScriptManager;
+class SetSearchIndexUpdater;
 class SetScriptContext;
 class Context;
 class Dependency;
@@ -59,6 +61,8 @@ public:
 
   ActionStack              actions;           ///< Actions performed on this set and the cards in it
   KeywordDatabase          keyword_db;        ///< Database for matching keywords, must be cleared when keywords change
+  QuickSearchIndexP        card_search_index;    ///< Index for searching the cards, kept up to date with the actions
+  QuickSearchIndexP        keyword_search_index; ///< Index for searching the keywords of the set and the game
   VCSP                     vcs;               ///< The version control system to use
   
   /// A context for performing scripts
@@ -110,9 +114,18 @@ public:
   /// Find the position of a card in this set, when the card list is sorted using the given cirterium
   int positionOfCard(const CardP& card, const ScriptValueP& order_by, const ScriptValueP& filter);
   /// Find the number of cards that match the given filter
+  /** Like positionOfCard this uses the order caches, so it throws when called from another thread than the main thread. */
   int numberOfCards(const ScriptValueP& filter);
-  /// Clear the order_cache used by positionOfCard
+  /// Clear the order_cache used by positionOfCard and numberOfCards
   void clearOrderCache();
+  /// The order of a card may have changed, or it was added or removed
+  /** Only that card is evaluated again when the order is next needed.
+   *  Without a card everything is cleared, as with clearOrderCache.
+   */
+  void invalidateOrderCache(const CardP& card);
+  
+  /// The keyword database, filled with the keywords of the set and game if it is empty
+  KeywordDatabase& keywordDatabase();
   
   String typeName() const override;
   Version fileVersion() const override;
@@ -133,9 +146,14 @@ private:
   unique_ptr<SetScriptManager> script_manager;
   /// Object for executing scripts from the thumbnail thread
   unique_ptr<SetScriptContext> thumbnail_script_context;
-  /// Cache of cards ordered by some criterion
+  /// Listener that tells the search indices which cards and keywords have changed
+  unique_ptr<SetSearchIndexUpdater> search_index_updater;
+  /// Cache of cards ordered by some criterion (order_by,filter), numberOfCards uses (nullptr,filter)
+  /** Kept up to date with invalidateOrderCache, called for values that order_by and filter depend on (DEP_ORDER_CACHE) */
   map<pair<ScriptValueP,ScriptValueP>,OrderCacheP> order_cache;
-  map<ScriptValueP,int>                            filter_cache;
+  
+  /// Get the order cache for the given criterion, evaluating order_by and filter for cards that are not up to date
+  OrderCache<CardP>& orderCache(const ScriptValueP& order_by, const ScriptValueP& filter);
 };
 
 inline String type_name(const Set&) {
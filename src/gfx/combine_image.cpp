@@ -9,6 +9,7 @@
 #include <util/prec.hpp>
 #include <gfx/gfx.hpp>
 #include <util/reflect.hpp>
+#include <util/trace.hpp>
 #include <algorithm>
 
 using namespace std;
@@ -140,6 +141,7 @@ void combine_image(Image& a, const Image& b, ImageCombine combine) {
 }
 
 void draw_combine_image(DC& dc, UInt x, UInt y, const Image& img, ImageCombine combine) {
+  TRACE_SCOPE("render", "draw combine image");
   if (combine <= COMBINE_NORMAL) {
     dc.DrawBitmap(img, x, y);
   } else {
@@ -9,12 +9,29 @@
 #include <util/prec.hpp>
 #include <gfx/generated_image.hpp>
 #include <util/io/package.hpp>
+#include <util/io/package_manager.hpp>
 #include <util/error.hpp>
 #include <data/symbol.hpp>
 #include <data/field/symbol.hpp>
 #include <render/symbol/filter.hpp>
 #include <gui/util.hpp> // load_resource_image
 
+// ----------------------------------------------------------------------------- : ImageHash
+
+void ImageHash::add(const void* data, size_t size) {
+  const unsigned char* bytes = (const unsigned char*)data;
+  for (size_t i = 0 ; i < size ; ++i) {
+    value ^= bytes[i];
+    value *= 1099511628211ULL;
+  }
+}
+
+void ImageHash::add(const String& str) {
+  wxScopedCharBuffer utf8 = str.utf8_str();
+  add(utf8.data(), utf8.length());
+  add(0);
+}
+
 // ----------------------------------------------------------------------------- : GeneratedImage
 
 ScriptType GeneratedImage::type() const { return SCRIPT_IMAGE; }
@@ -93,6 +110,10 @@ bool BlankImage::operator == (const GeneratedImage& that) const {
   const BlankImage* that2 = dynamic_cast<const BlankImage*>(&that);
   return that2;
 }
+bool BlankImage::hash(ImageHash& h, const Options& opt) const {
+  h.add("blank");
+  return true;
+}
 
 // ----------------------------------------------------------------------------- : LinearBlendImage
 
@@ -111,6 +132,10 @@ bool LinearBlendImage::operator == (const GeneratedImage& that) const {
                && x1 == that2->x1 && y1 == that2->y1
                && x2 == that2->x2 && y2 == that2->y2;
 }
+bool LinearBlendImage::hash(ImageHash& h, const Options& opt) const {
+  h.add("linear_blend"); h.add(x1); h.add(y1); h.add(x2); h.add(y2);
+  return image1->hash(h, opt) && image2->hash(h, opt);
+}
 
 // ----------------------------------------------------------------------------- : MaskedBlendImage
 
@@ -128,6 +153,10 @@ bool MaskedBlendImage::operator == (const GeneratedImage& that) const {
                && *dark  == *that2->dark
                && *mask  == *that2->mask;
 }
+bool MaskedBlendImage::hash(ImageHash& h, const Options& opt) const {
+  h.add("masked_blend");
+  return light->hash(h, opt) && dark->hash(h, opt) && mask->hash(h, opt);
+}
 
 // ----------------------------------------------------------------------------- : CombineBlendImage
 
@@ -145,6 +174,10 @@ bool CombineBlendImage::operator == (const GeneratedImage& that) const {
                && *image2 == *that2->image2
                && image_combine == that2->image_combine;
 }
+bool CombineBlendImage::hash(ImageHash& h, const Options& opt) const {
+  h.add("combine_blend"); h.add((int)image_combine);
+  return image1->hash(h, opt) && image2->hash(h, opt);
+}
 
 // ----------------------------------------------------------------------------- : SetMaskImage
 
@@ -158,6 +191,10 @@ bool SetMaskImage::operator == (const GeneratedImage& that) const {
   return that2 && *image == *that2->image
                && *mask  == *that2->mask;
 }
+bool SetMaskImage::hash(ImageHash& h, const Options& opt) const {
+  h.add("set_mask");
+  return image->hash(h, opt) && mask->hash(h, opt);
+}
 
 Image SetAlphaImage::generate(const Options& opt) const {
   Image img = image->generate(opt);
@@ -169,6 +206,10 @@ bool SetAlphaImage::operator == (const GeneratedImage& that) const {
   return that2 && *image == *that2->image
                && alpha  == that2->alpha;
 }
+bool SetAlphaImage::hash(ImageHash& h, const Options& opt) const {
+  h.add("set_alpha"); h.add(alpha);
+  return image->hash(h, opt);
+}
 
 // ----------------------------------------------------------------------------- : SetCombineImage
 
@@ -183,6 +224,10 @@ bool SetCombineImage::operator == (const GeneratedImage& that) const {
   return that2 && *image == *that2->image
                && image_combine == that2->image_combine;
 }
+bool SetCombineImage::hash(ImageHash& h, const Options& opt) const {
+  h.add("set_combine"); h.add((int)image_combine);
+  return image->hash(h, opt);
+}
 
 // ----------------------------------------------------------------------------- : SaturateImage
 
@@ -196,6 +241,10 @@ bool SaturateImage::operator == (const GeneratedImage& that) const {
   return that2 && *image == *that2->image
                && amount == that2->amount;
 }
+bool SaturateImage::hash(ImageHash& h, const Options& opt) const {
+  h.add("saturate"); h.add(amount);
+  return image->hash(h, opt);
+}
 
 // ----------------------------------------------------------------------------- : InvertImage
 
@@ -208,6 +257,10 @@ bool InvertImage::operator == (const GeneratedImage& that) const {
   const InvertImage* that2 = dynamic_cast<const InvertImage*>(&that);
   return that2 && *image == *that2->image;
 }
+bool InvertImage::hash(ImageHash& h, const Options& opt) const {
+  h.add("invert");
+  return image->hash(h, opt);
+}
 
 // ----------------------------------------------------------------------------- : RecolorImage
 
@@ -221,6 +274,10 @@ bool RecolorImage::operator == (const GeneratedImage& that) const {
   return that2 && *image == *that2->image
                && color == that2->color;
 }
+bool RecolorImage::hash(ImageHash& h, const Options& opt) const {
+  h.add("recolor"); h.add(color.packed);
+  return image->hash(h, opt);
+}
 
 Image RecolorImage2::generate(const Options& opt) const {
   Image img = image->generate(opt);
@@ -235,6 +292,10 @@ bool RecolorImage2::operator == (const GeneratedImage& that) const {
                && blue == that2->blue
                && white == that2->white;
 }
+bool RecolorImage2::hash(ImageHash& h, const Options& opt) const {
+  h.add("recolor2"); h.add(red.packed); h.add(green.packed); h.add(blue.packed); h.add(white.packed);
+  return image->hash(h, opt);
+}
 
 // ----------------------------------------------------------------------------- : FlipImage
 
@@ -246,6 +307,10 @@ bool FlipImageHorizontal::operator == (const GeneratedImage& that) const {
   const FlipImageHorizontal* that2 = dynamic_cast<const FlipImageHorizontal*>(&that);
   return that2 && *image == *that2->image;
 }
+bool FlipImageHorizontal::hash(ImageHash& h, const Options& opt) const {
+  h.add("flip_horizontal");
+  return image->hash(h, opt);
+}
 
 Image FlipImageVertical::generate(const Options& opt) const {
   Image img = image->generate(opt);
@@ -255,6 +320,10 @@ bool FlipImageVertical::operator == (const GeneratedImage& that) const {
   const FlipImageVertical* that2 = dynamic_cast<const FlipImageVertical*>(&that);
   return that2 && *image == *that2->image;
 }
+bool FlipImageVertical::hash(ImageHash& h, const Options& opt) const {
+  h.add("flip_vertical");
+  return image->hash(h, opt);
+}
 
 Image RotateImage::generate(const Options& opt) const {
   Image img = image->generate(opt);
@@ -265,6 +334,10 @@ bool RotateImage::operator == (const GeneratedImage& that) const {
   return that2 && *image == *that2->image
                && angle == that2->angle;
 }
+bool RotateImage::hash(ImageHash& h, const Options& opt) const {
+  h.add("rotate"); h.add(angle);
+  return image->hash(h, opt);
+}
 
 // ----------------------------------------------------------------------------- : EnlargeImage
 
@@ -303,6 +376,10 @@ bool EnlargeImage::operator == (const GeneratedImage& that) const {
   return that2 && *image      == *that2->image
                && border_size == that2->border_size;
 }
+bool EnlargeImage::hash(ImageHash& h, const Options& opt) const {
+  h.add("enlarge"); h.add(border_size);
+  return image->hash(h, opt);
+}
 
 // ----------------------------------------------------------------------------- : CropImage
 
@@ -315,6 +392,10 @@ bool CropImage::operator == (const GeneratedImage& that) const {
                && width    == that2->width    && height   == that2->height
                && offset_x == that2->offset_x && offset_y == that2->offset_y;
 }
+bool CropImage::hash(ImageHash& h, const Options& opt) const {
+  h.add("crop"); h.add(width); h.add(height); h.add(offset_x); h.add(offset_y);
+  return image->hash(h, opt);
+}
 
 // ----------------------------------------------------------------------------- : DropShadowImage
 
@@ -407,6 +488,10 @@ bool DropShadowImage::operator == (const GeneratedImage& that) const {
                && shadow_alpha == that2->shadow_alpha && shadow_blur_radius == that2->shadow_blur_radius
                && shadow_color == that2->shadow_color;
 }
+bool DropShadowImage::hash(ImageHash& h, const Options& opt) const {
+  h.add("drop_shadow"); h.add(offset_x); h.add(offset_y); h.add(shadow_alpha); h.add(shadow_blur_radius); h.add(shadow_color.packed);
+  return image->hash(h, opt);
+}
 
 // ----------------------------------------------------------------------------- : PackagedImage
 
@@ -427,6 +512,37 @@ bool PackagedImage::operator == (const GeneratedImage& that) const {
   const PackagedImage* that2 = dynamic_cast<const PackagedImage*>(&that);
   return that2 && filename == that2->filename;
 }
+bool PackagedImage::hash(ImageHash& h, const Options& opt) const {
+  if (!opt.package) return false;
+  // the image depends on the version of the file, in the package that it is actually loaded from
+  h.add("packaged"); h.add(filename);
+  Package* package = opt.package;
+  String file = filename;
+  PackagedP other;
+  if (!file.empty() && file.GetChar(0) == _('/')) {
+    // absolute name, the file is in another package (see PackageManager::openFileFromPackage)
+    size_t start = file.find_first_not_of(_("/\\"), 1);
+    size_t pos   = file.find_first_of(_("/\\"), start);
+    if (start >= pos || pos == String::npos) return false;
+    try {
+      other = package_manager.openAny(file.substr(start, pos - start), true);
+    } catch (const Error&) {
+      return false; // generating the image will report the error
+    }
+    package = other.get();
+    file = file.substr(pos + 1);
+  }
+  h.add(package->absoluteFilename());
+  wxFileName fn(package->absoluteFilename() + _("/") + file);
+  if (fn.FileExists()) {
+    // a file in a directory package, the directory doesn't change when the file does
+    h.add((long long)fn.GetModificationTime().GetValue().GetValue());
+    h.add((long long)fn.GetSize().GetValue());
+  } else {
+    h.add((long long)package->lastModified().GetValue().GetValue());
+  }
+  return true;
+}
 
 // ----------------------------------------------------------------------------- : BuiltInImage
 
@@ -442,6 +558,10 @@ bool BuiltInImage::operator == (const GeneratedImage& that) const {
   const BuiltInImage* that2 = dynamic_cast<const BuiltInImage*>(&that);
   return that2 && name == that2->name;
 }
+bool BuiltInImage::hash(ImageHash& h, const Options& opt) const {
+  h.add("built_in"); h.add(name);
+  return true;
+}
 
 // ----------------------------------------------------------------------------- : SymbolToImage
 
@@ -18,6 +18,25 @@ DECLARE_POINTER_TYPE(GeneratedImage);
 DECLARE_POINTER_TYPE(SymbolVariation);
 class Package;
 
+// ----------------------------------------------------------------------------- : ImageHash
+
+/// A hash of the structure of a GeneratedImage, that is stable between runs of the program
+/** Uses 64 bit FNV-1a */
+class ImageHash {
+public:
+  inline ImageHash() : value(14695981039346656037ULL) {}
+
+  void add(const void* data, size_t size);
+  inline void add(const char* str)    { add(str, strlen(str) + 1); }
+  inline void add(int x)              { add(&x, sizeof(x)); }
+  inline void add(uint32_t x)         { add(&x, sizeof(x)); }
+  inline void add(long long x)        { add(&x, sizeof(x)); }
+  inline void add(double x)           { add(&x, sizeof(x)); }
+  void add(const String& str);
+
+  uint64_t value;
+};
+
 // ----------------------------------------------------------------------------- : GeneratedImage
 
 /// An image that is generated from a script.
@@ -52,6 +71,11 @@ public:
   /// Equality should mean that every pixel in the generated images is the same if the same options are used
   virtual bool operator == (const GeneratedImage& that) const = 0;
   inline  bool operator != (const GeneratedImage& that) const { return !(*this == that); }
+  /// Add a hash of this image to h, images with the same hash should generate the same pixels
+  /** Returns false if the image can not be cached between runs, for instance because it depends on the set.
+   *  The hash should not depend on the requested size, that is handled by GeneratedImageCache.
+   */
+  virtual bool hash(ImageHash& h, const Options& opt) const { return false; }
   
   /// Can this image be generated safely from another thread?
   virtual bool threadSafe() const { return true; }
@@ -59,6 +83,8 @@ public:
   virtual bool local() const { return false; }
   /// Is this image blank?
   virtual bool isBlank() const { return false; }
+  /// Is this image read directly from a file? Then there is no point in also keeping it in the disk cache
+  virtual bool isFile() const { return false; }
   
   ScriptType type() const override;
   String typeName() const override;
@@ -89,6 +115,7 @@ class BlankImage : public GeneratedImage {
 public:
   Image generate(const Options&) const override;
   bool operator == (const GeneratedImage& that) const override;
+  bool hash(ImageHash& h, const Options& opt) const override;
   bool isBlank() const override { return true; }
   
   // Why is this not thread safe? What is GTK smoking?
@@ -108,6 +135,7 @@ public:
   Image generate(const Options& opt) const override;
   ImageCombine combine() const override;
   bool operator == (const GeneratedImage& that) const override;
+  bool hash(ImageHash& h, const Options& opt) const override;
   bool local() const override { return image1->local() && image2->local(); }
 private:
   GeneratedImageP image1, image2;
@@ -125,6 +153,7 @@ public:
   Image generate(const Options& opt) const override;
   ImageCombine combine() const override;
   bool operator == (const GeneratedImage& that) const override;
+  bool hash(ImageHash& h, const Options& opt) const override;
   bool local() const override { return light->local() && dark->local() && mask->local(); }
 private:
   GeneratedImageP light, dark, mask;
@@ -141,6 +170,7 @@ public:
   Image generate(const Options& opt) const override;
   ImageCombine combine() const override;
   bool operator == (const GeneratedImage& that) const override;
+  bool hash(ImageHash& h, const Options& opt) const override;
   bool local() const override { return image1->local() && image2->local(); }
 private:
   GeneratedImageP image1, image2;
@@ -157,6 +187,7 @@ public:
   {}
   Image generate(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  bool hash(ImageHash& h, const Options& opt) const override;
 private:
   GeneratedImageP mask;
 };
@@ -169,6 +200,7 @@ public:
   {}
   Image generate(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  bool hash(ImageHash& h, const Options& opt) const override;
 private:
   double alpha;
 };
@@ -184,6 +216,7 @@ public:
   Image generate(const Options& opt) const override;
   ImageCombine combine() const override;
   bool operator == (const GeneratedImage& that) const override;
+  bool hash(ImageHash& h, const Options& opt) const override;
 private:
   ImageCombine image_combine;
 };
@@ -198,6 +231,7 @@ public:
   {}
   Image generate(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  bool hash(ImageHash& h, const Options& opt) const override;
 private:
   double amount;
 };
@@ -212,6 +246,7 @@ public:
   {}
   Image generate(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  bool hash(ImageHash& h, const Options& opt) const override;
 };
 
 // ----------------------------------------------------------------------------- : RecolorImage
@@ -224,6 +259,7 @@ public:
   {}
   Image generate(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  bool hash(ImageHash& h, const Options& opt) const override;
 private:
   Color color;
 };
@@ -235,6 +271,7 @@ public:
   {}
   Image generate(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  bool hash(ImageHash& h, const Options& opt) const override;
 private:
   Color red,green,blue,white;
 };
@@ -249,6 +286,7 @@ public:
   {}
   Image generate(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  bool hash(ImageHash& h, const Options& opt) const override;
 };
 
 /// Flip an image vertically
@@ -259,6 +297,7 @@ public:
   {}
   Image generate(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  bool hash(ImageHash& h, const Options& opt) const override;
 };
 
 /// Rotate an image
@@ -269,6 +308,7 @@ public:
   {}
   Image generate(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  bool hash(ImageHash& h, const Options& opt) const override;
 private:
   Radians angle;
 };
@@ -283,6 +323,7 @@ public:
   {}
   Image generate(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  bool hash(ImageHash& h, const Options& opt) const override;
 private:
   double border_size;
 };
@@ -297,6 +338,7 @@ public:
   {}
   Image generate(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  bool hash(ImageHash& h, const Options& opt) const override;
 private:
   double width, height;
   double offset_x, offset_y;
@@ -313,6 +355,7 @@ public:
   {}
   Image generate(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  bool hash(ImageHash& h, const Options& opt) const override;
 private:
   double offset_x, offset_y;
   double shadow_alpha;
@@ -330,6 +373,8 @@ public:
   {}
   Image generate(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  bool hash(ImageHash& h, const Options& opt) const override;
+  bool isFile() const override { return true; }
 private:
   String filename;
 };
@@ -344,6 +389,7 @@ public:
   {}
   Image generate(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  bool hash(ImageHash& h, const Options& opt) const override;
 private:
   String name;
 };
@@ -57,6 +57,12 @@ void draw_resampled_text(DC& dc, const RealPoint& pos, const RealRect& rect, dou
 // scaling factor to use when drawing resampled text
 extern const int text_scaling;
 
+/// Should draw_resampled_text cache the coverage of text it draws?
+/** Only turned off to compare with drawing all text, in benchmarks */
+extern bool resampled_text_cache_enabled;
+/// Forget the coverage cached by draw_resampled_text, for benchmarks
+void clear_text_coverage_cache();
+
 // ----------------------------------------------------------------------------- : Image rotation
 
 /// Rotates an image counter clockwise
@@ -0,0 +1,265 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <gfx/image_cache.hpp>
+#include <util/file_utils.hpp>
+#include <util/trace.hpp>
+#include <util/version.hpp>
+#include <wx/dir.h>
+#include <wx/filename.h>
+
+// ----------------------------------------------------------------------------- : Cache directory
+
+String user_settings_dir();
+String image_cache_dir() {
+  String dir = user_settings_dir() + _("/cache");
+  if (!wxDirExists(dir)) wxMkdir(dir);
+  return dir + _("/");
+}
+
+// ----------------------------------------------------------------------------- : GeneratedImageCache
+
+GeneratedImageCache generated_image_cache;
+
+/// Change this when the format of the cache changes, so old files in the cache are no longer used
+/** Files from other versions of the program are not used either, since blending, resampling and
+ *  the built in images can change between versions.
+ */
+const int IMAGE_CACHE_VERSION = 1;
+
+GeneratedImageCache::GeneratedImageCache()
+  : memory_budget(64 << 20)
+  , disk_budget(256 << 20)
+  , memory_size(0), disk_size(0)
+  , clock(0)
+  , disk_loaded(false)
+  , pending_size(0)
+  , writing(false)
+  , written(mutex)
+{}
+
+/// Number of bytes used by an image in memory
+size_t image_bytes(const Image& image) {
+  return (size_t)image.GetWidth() * image.GetHeight() * (image.HasAlpha() ? 4 : 3);
+}
+
+Image GeneratedImageCache::generate(const GeneratedImage& image, const GeneratedImage::Options& options) {
+  // the key is the structure of the image, together with the options that affect the result
+  ImageHash h;
+  h.add(IMAGE_CACHE_VERSION);
+  h.add((long long)app_version.toNumber());
+  h.add(String(version_suffix));
+  if (options.angle != 0 || !image.hash(h, options)) {
+    return image.generateConform(options);
+  }
+  h.add(options.width);
+  h.add(options.height);
+  h.add(options.zoom);
+  h.add((int)options.preserve_aspect);
+  h.add((int)options.saturate);
+  uint64_t key = h.value;
+  bool use_disk = disk_budget > 0 && !image.isFile();
+  // in memory?
+  Image img;
+  String filename;
+  {
+    wxMutexLocker lock(mutex);
+    auto it = memory.find(key);
+    if (it != memory.end()) {
+      it->second.last_use = ++clock;
+      // copy, because callers modify the image in place (for instance to apply a mask)
+      img = it->second.image.Copy();
+    } else if (use_disk) {
+      loadDiskIndex();
+      auto it = disk.find(key);
+      if (it != disk.end()) {
+        it->second.last_use = ++clock;
+        filename = filenameFor(key);
+      }
+    }
+  }
+  // on disk?
+  if (!img.Ok() && !filename.empty()) {
+    TRACE_SCOPE("image", "load cached image");
+    wxLogNull noLog; // the file could have been removed by another instance of the program
+    if (img.LoadFile(filename, wxBITMAP_TYPE_PNG)) {
+      wxFileName(filename).Touch(); // for the least recently used order in the next run
+      wxMutexLocker lock(mutex);
+      storeInMemory(key, img);
+    }
+  }
+  if (img.Ok()) {
+    options.width  = img.GetWidth();
+    options.height = img.GetHeight();
+    return img;
+  }
+  // generate
+  {
+    TRACE_SCOPE("image", "generate image");
+    img = image.generateConform(options);
+  }
+  {
+    wxMutexLocker lock(mutex);
+    storeInMemory(key, img);
+    if (use_disk) queueWrite(key, img);
+  }
+  return img;
+}
+
+void GeneratedImageCache::clear() {
+  wxMutexLocker lock(mutex);
+  memory.clear();
+  memory_size = 0;
+}
+
+void GeneratedImageCache::flush() {
+  wxMutexLocker lock(mutex);
+  while (writing) written.Wait();
+}
+
+// ----------------------------------------------------------------------------- : GeneratedImageCache : writing
+
+/// Thread that writes the pending images of the cache to disk
+class ImageCacheWriter : public wxThread {
+public:
+  ImageCacheWriter(GeneratedImageCache& cache) : cache(cache) {}
+  ExitCode Entry() override {
+    cache.writePending();
+    return 0;
+  }
+private:
+  GeneratedImageCache& cache;
+};
+
+void GeneratedImageCache::queueWrite(uint64_t key, const Image& image) {
+  // when the writer can't keep up, it is better to not cache some images than to hold on to all of them
+  size_t bytes = image_bytes(image);
+  if (pending_size + bytes > memory_budget) return;
+  pending.push_back(make_pair(key, image.Copy()));
+  pending_size += bytes;
+  if (!writing) {
+    ImageCacheWriter* writer = new ImageCacheWriter(*this);
+    if (writer->Create() == wxTHREAD_NO_ERROR && writer->Run() == wxTHREAD_NO_ERROR) {
+      writing = true;
+    } else {
+      delete writer;
+      pending.clear();
+      pending_size = 0;
+    }
+  }
+}
+
+void GeneratedImageCache::writePending() {
+  wxLogNull noLog;
+  while (true) {
+    pair<uint64_t,Image> item;
+    {
+      wxMutexLocker lock(mutex);
+      if (pending.empty()) {
+        writing = false;
+        written.Broadcast();
+        return;
+      }
+      item = pending.front();
+      pending.pop_front();
+      pending_size -= image_bytes(item.second);
+      loadDiskIndex();
+    }
+    // write to a temporary file first, so other programs never see half written files
+    TRACE_SCOPE("image", "write cached image");
+    String filename = filenameFor(item.first);
+    String temp_filename = filename + wxString::Format(_(".%lu.tmp"), wxGetProcessId());
+    if (item.second.SaveFile(temp_filename, wxBITMAP_TYPE_PNG) && wxRenameFile(temp_filename, filename, true)) {
+      size_t bytes = (size_t)wxFileName::GetSize(filename).GetValue();
+      wxMutexLocker lock(mutex);
+      storeOnDisk(item.first, bytes);
+    } else {
+      remove_file(temp_filename);
+    }
+  }
+}
+
+String GeneratedImageCache::filenameFor(uint64_t key) const {
+  return directory + wxString::Format(_("%016llx.png"), (unsigned long long)key);
+}
+
+void GeneratedImageCache::loadDiskIndex() {
+  if (disk_loaded) return;
+  disk_loaded = true;
+  directory = image_cache_dir() + _("generated");
+  if (!wxDirExists(directory)) wxMkdir(directory);
+  directory += _("/");
+  // find the files, and order them by the time they were last used
+  vector<pair<wxDateTime,uint64_t>> files;
+  wxDir dir(directory);
+  if (!dir.IsOpened()) return;
+  String name;
+  for (bool ok = dir.GetFirst(&name, _("*.png"), wxDIR_FILES) ; ok ; ok = dir.GetNext(&name)) {
+    unsigned long long key;
+    if (name.size() != 20 || !name.substr(0,16).ToULongLong(&key, 16)) continue;
+    wxFileName fn(directory + name);
+    Item item;
+    item.bytes    = (size_t)fn.GetSize().GetValue();
+    item.last_use = 0;
+    disk[key] = item;
+    disk_size += item.bytes;
+    files.push_back(make_pair(fn.GetModificationTime(), (uint64_t)key));
+  }
+  sort(files.begin(), files.end());
+  FOR_EACH(f, files) {
+    disk[f.second].last_use = ++clock;
+  }
+  evictDisk();
+}
+
+void GeneratedImageCache::storeInMemory(uint64_t key, const Image& image) {
+  Item& item = memory[key];
+  memory_size -= item.bytes;
+  item.image    = image.Copy();
+  item.bytes    = image_bytes(image);
+  item.last_use = ++clock;
+  memory_size += item.bytes;
+  evictMemory();
+}
+
+void GeneratedImageCache::storeOnDisk(uint64_t key, size_t bytes) {
+  Item& item = disk[key];
+  disk_size -= item.bytes;
+  item.bytes    = bytes;
+  item.last_use = ++clock;
+  disk_size += item.bytes;
+  evictDisk();
+}
+
+/// The least recently used item
+template <typename Items>
+typename Items::iterator least_recently_used(Items& items) {
+  auto oldest = items.begin();
+  for (auto it = items.begin() ; it != items.end() ; ++it) {
+    if (it->second.last_use < oldest->second.last_use) oldest = it;
+  }
+  return oldest;
+}
+
+void GeneratedImageCache::evictMemory() {
+  while (memory_size > memory_budget && memory.size() > 1) {
+    auto it = least_recently_used(memory);
+    memory_size -= it->second.bytes;
+    memory.erase(it);
+  }
+}
+
+void GeneratedImageCache::evictDisk() {
+  while (disk_size > disk_budget && !disk.empty()) {
+    auto it = least_recently_used(disk);
+    remove_file(filenameFor(it->first));
+    disk_size -= it->second.bytes;
+    disk.erase(it);
+  }
+}
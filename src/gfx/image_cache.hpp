@@ -0,0 +1,85 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#pragma once
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <gfx/generated_image.hpp>
+#include <wx/thread.h>
+#include <deque>
+
+// ----------------------------------------------------------------------------- : GeneratedImageCache
+
+/// A cache of generated images, shared between all cards and kept on disk between runs
+/** Images are identified by their structural hash (GeneratedImage::hash) together with the options.
+ *  The most recently used images are kept in memory, and all images are stored as png files in the image cache directory.
+ *  Both have a size budget, when it is exceeded the least recently used images are removed.
+ *  The png files are written by a background thread, so encoding them doesn't slow down rendering.
+ *
+ *  Images that depend on the set (GeneratedImage::hash returns false) are not cached.
+ *  Images read directly from a file (GeneratedImage::isFile) are only cached in memory.
+ *  The cache can be used from multiple threads.
+ */
+class GeneratedImageCache {
+public:
+  GeneratedImageCache();
+
+  /// Generate an image, conforming to the options, or get it from the cache
+  /** Like ScriptableImage::generate, sets options.width and options.height to the size of the image. */
+  Image generate(const GeneratedImage& image, const GeneratedImage::Options& options);
+
+  /// Remove all images from memory
+  void clear();
+  /// Wait until the queued images are written to disk
+  void flush();
+
+  size_t memory_budget; ///< Maximum number of bytes of images to keep in memory
+  size_t disk_budget;   ///< Maximum number of bytes of png files to keep on disk, 0 to disable the disk cache
+
+private:
+  struct Item {
+    size_t   bytes    = 0;
+    uint64_t last_use = 0;
+    Image    image; ///< The image, only for items in memory
+  };
+  wxMutex              mutex;
+  map<uint64_t,Item>   memory;
+  map<uint64_t,Item>   disk;
+  size_t               memory_size, disk_size;
+  uint64_t             clock;       ///< Counter for finding the least recently used items
+  bool                 disk_loaded; ///< Has the disk index been read?
+  String               directory;   ///< Directory for the png files
+  deque<pair<uint64_t,Image>> pending; ///< Images still to be written to disk
+  size_t               pending_size;
+  bool                 writing;     ///< Is there a thread writing the pending images?
+  wxCondition          written;     ///< Signaled when the writer thread is done
+  
+  friend class ImageCacheWriter;
+
+  String filenameFor(uint64_t key) const;
+  /// Read the names, sizes and times of the files in the cache directory
+  void loadDiskIndex();
+  /// Add an image to the memory cache
+  void storeInMemory(uint64_t key, const Image& image);
+  /// Queue an image to be written to the disk cache, starts a writer thread if needed
+  void queueWrite(uint64_t key, const Image& image);
+  /// Write the pending images, until there are none left (on the writer thread)
+  void writePending();
+  /// Add a file to the disk cache
+  void storeOnDisk(uint64_t key, size_t bytes);
+  /// Remove least recently used images until the memory cache is within budget
+  void evictMemory();
+  /// Remove least recently used files until the disk cache is within budget
+  void evictDisk();
+};
+
+/// The global image cache
+extern GeneratedImageCache generated_image_cache;
+
+/// The directory for cached images, including a trailing slash. It is created if needed.
+String image_cache_dir();
@@ -0,0 +1,226 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+// Note: no util/prec.hpp, this file is also compiled into the benchmark, without wxWidgets
+#include <gfx/pixel_kernels.hpp>
+#include <assert.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define USE_SSE2 1
+  #include <emmintrin.h>
+#else
+  #define USE_SSE2 0
+#endif
+
+// ----------------------------------------------------------------------------- : Utilities
+
+inline size_t min_size(size_t a, size_t b) {
+  return a < b ? a : b;
+}
+
+inline unsigned char clamp_byte(int x) {
+  return (unsigned char)(x < 0 ? 0 : x > 255 ? 255 : x);
+}
+
+/// x / 255 for x in [0, 255*255]
+inline int div255(int x) {
+  return (x + 1 + (x >> 8)) >> 8;
+}
+
+#if USE_SSE2
+  /// x / 255 for 16 bit lanes with x in [0, 255*255]
+  inline __m128i div255_epu16(__m128i x) {
+    return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)), _mm_srli_epi16(x, 8)), 8);
+  }
+#endif
+
+/// Number of subpixels to process at a time in kernels that divide
+const size_t DIVIDE_BLOCK = 3 * 128;
+
+/// out[i] = clamp(num[i] / den[i]), with division rounding towards zero
+/** For |num| < 2^24, 0 < den < 1024 and the quotients that matter (in [0,256)) a float division gives the exact same result,
+ *  which allows four divisions at a time.
+ */
+void divide_clamp(const int* num, const int* den, unsigned char* out, size_t count) {
+  size_t i = 0;
+  #if USE_SSE2
+    for ( ; i + 8 <= count ; i += 8) {
+      __m128i q_lo = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(num + i))),
+                                                 _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(den + i)))));
+      __m128i q_hi = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(num + i + 4))),
+                                                 _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(den + i + 4)))));
+      // saturating packs clamp to [0,255]
+      __m128i q = _mm_packus_epi16(_mm_packs_epi32(q_lo, q_hi), _mm_setzero_si128());
+      _mm_storel_epi64((__m128i*)(out + i), q);
+    }
+  #endif
+  for ( ; i < count ; ++i) {
+    out[i] = clamp_byte(num[i] / den[i]);
+  }
+}
+
+// ----------------------------------------------------------------------------- : Blending
+
+void linear_blend_row(unsigned char* data1, const unsigned char* data2, int width, int mult, int step) {
+  const int fixed = 1<<16;
+  for (int x = 0 ; x < width ; ++x, mult += step, data1 += 3, data2 += 3) {
+    if (mult <= 0) {
+      // keep data1
+    } else if (mult >= fixed) {
+      data1[0] = data2[0];
+      data1[1] = data2[1];
+      data1[2] = data2[2];
+    } else {
+      data1[0] = data1[0] + mult * (data2[0] - data1[0]) / fixed;
+      data1[1] = data1[1] + mult * (data2[1] - data1[1]) / fixed;
+      data1[2] = data1[2] + mult * (data2[2] - data1[2]) / fixed;
+    }
+  }
+}
+
+void mask_blend_bytes(unsigned char* data1, const unsigned char* data2, const unsigned char* mask, size_t count) {
+  size_t i = 0;
+  #if USE_SSE2
+    const __m128i zero = _mm_setzero_si128(), c255 = _mm_set1_epi16(255);
+    for ( ; i + 16 <= count ; i += 16) {
+      __m128i a = _mm_loadu_si128((const __m128i*)(data1 + i));
+      __m128i b = _mm_loadu_si128((const __m128i*)(data2 + i));
+      __m128i m = _mm_loadu_si128((const __m128i*)(mask  + i));
+      __m128i m_lo = _mm_unpacklo_epi8(m, zero), m_hi = _mm_unpackhi_epi8(m, zero);
+      __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), m_lo),
+                                 _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), _mm_sub_epi16(c255, m_lo)));
+      __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), m_hi),
+                                 _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), _mm_sub_epi16(c255, m_hi)));
+      _mm_storeu_si128((__m128i*)(data1 + i), _mm_packus_epi16(div255_epu16(lo), div255_epu16(hi)));
+    }
+  #endif
+  for ( ; i < count ; ++i) {
+    data1[i] = (unsigned char)div255(data1[i] * mask[i] + data2[i] * (255 - mask[i]));
+  }
+}
+
+// ----------------------------------------------------------------------------- : Alpha
+
+void multiply_bytes(unsigned char* data, const unsigned char* factor, size_t count) {
+  size_t i = 0;
+  #if USE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for ( ; i + 16 <= count ; i += 16) {
+      __m128i a = _mm_loadu_si128((const __m128i*)(data   + i));
+      __m128i f = _mm_loadu_si128((const __m128i*)(factor + i));
+      __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(f, zero));
+      __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(f, zero));
+      _mm_storeu_si128((__m128i*)(data + i), _mm_packus_epi16(div255_epu16(lo), div255_epu16(hi)));
+    }
+  #endif
+  for ( ; i < count ; ++i) {
+    data[i] = (unsigned char)div255(data[i] * factor[i]);
+  }
+}
+
+void multiply_bytes(unsigned char* data, unsigned char factor, size_t count) {
+  size_t i = 0;
+  #if USE_SSE2
+    const __m128i zero = _mm_setzero_si128(), f = _mm_set1_epi16(factor);
+    for ( ; i + 16 <= count ; i += 16) {
+      __m128i a = _mm_loadu_si128((const __m128i*)(data + i));
+      __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), f);
+      __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), f);
+      _mm_storeu_si128((__m128i*)(data + i), _mm_packus_epi16(div255_epu16(lo), div255_epu16(hi)));
+    }
+  #endif
+  for ( ; i < count ; ++i) {
+    data[i] = (unsigned char)div255(data[i] * factor);
+  }
+}
+
+// ----------------------------------------------------------------------------- : Color effects
+
+void invert_bytes(unsigned char* data, size_t count) {
+  size_t i = 0;
+  #if USE_SSE2
+    const __m128i ones = _mm_set1_epi8(-1);
+    for ( ; i + 16 <= count ; i += 16) {
+      __m128i a = _mm_loadu_si128((const __m128i*)(data + i));
+      _mm_storeu_si128((__m128i*)(data + i), _mm_xor_si128(a, ones));
+    }
+  #endif
+  for ( ; i < count ; ++i) {
+    data[i] = 255 - data[i];
+  }
+}
+
+void saturate_pixels(unsigned char* pix, size_t count, int factor) {
+  unsigned char* end = pix + 3 * count;
+  if (factor == 0) {
+    return; // nothing to do
+  } else if (factor == 256) {
+    // super crazy saturation: division by zero
+    // if we take infty to be 255, then it is a >avg test
+    for ( ; pix != end ; pix += 3) {
+      int r = pix[0], g = pix[1], b = pix[2];
+      pix[0] = r+r > g+b ? 255 : 0;
+      pix[1] = g+g > b+r ? 255 : 0;
+      pix[2] = b+b > r+g ? 255 : 0;
+    }
+  } else if (factor > 0) {
+    int div = 768 - 3 * factor;
+    assert(div > 0);
+    int num[DIVIDE_BLOCK], den[DIVIDE_BLOCK];
+    for (size_t i = 0 ; i < DIVIDE_BLOCK ; ++i) den[i] = div;
+    while (pix != end) {
+      size_t n = min_size(end - pix, DIVIDE_BLOCK);
+      for (size_t i = 0 ; i < n ; i += 3) {
+        int avg = factor*(pix[i] + pix[i+1] + pix[i+2]);
+        num[i]   = 768*pix[i]   - avg;
+        num[i+1] = 768*pix[i+1] - avg;
+        num[i+2] = 768*pix[i+2] - avg;
+      }
+      divide_clamp(num, den, pix, n);
+      pix += n;
+    }
+  } else {
+    int factor1 = -factor;
+    int factor2 = 768 - 3*factor1;
+    for ( ; pix != end ; pix += 3) {
+      int r = pix[0], g = pix[1], b = pix[2];
+      int avg = factor1*(r+g+b);
+      pix[0] = (unsigned char)((factor2*r + avg) / 768);
+      pix[1] = (unsigned char)((factor2*g + avg) / 768);
+      pix[2] = (unsigned char)((factor2*b + avg) / 768);
+    }
+  }
+}
+
+void recolor_pixels(unsigned char* pix, size_t count, const unsigned char* cr, const unsigned char* cg, const unsigned char* cb, const unsigned char* cw) {
+  unsigned char* end = pix + 3 * count;
+  int num[DIVIDE_BLOCK], den[DIVIDE_BLOCK];
+  while (pix != end) {
+    size_t n = min_size(end - pix, DIVIDE_BLOCK);
+    for (size_t i = 0 ; i < n ; i += 3) {
+      int r = pix[i], g = pix[i+1], b = pix[i+2];
+      int lo = r < g ? (r < b ? r : b) : (g < b ? g : b);
+      // amount of each
+      int nr = r - lo;
+      int ng = g - lo;
+      int nb = b - lo;
+      int nw = lo;
+      // We should have that nr+ng+bw+nw < 255,
+      //  otherwise the input is not a mixture of red/green/blue/white.
+      // Just to be sure, divide by the sum instead of 255
+      int total = nr+ng+nb+nw;
+      if (total < 255) total = 255;
+      for (int c = 0 ; c < 3 ; ++c) {
+        num[i+c] = nr * cr[c] + ng * cg[c] + nb * cb[c] + nw * cw[c];
+        den[i+c] = total;
+      }
+    }
+    divide_clamp(num, den, pix, n);
+    pix += n;
+  }
+}
@@ -0,0 +1,44 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#pragma once
+
+/** @file gfx/pixel_kernels.hpp
+ *
+ *  Inner loops of the image processing functions, working on raw pixel data.
+ *
+ *  These are used for every layer of every card frame, so they use SSE2 when the compiler targets it
+ *  (always the case on x86-64). The results are exactly the same as those of the straightforward loops.
+ *
+ *  This file doesn't depend on wxWidgets, so the kernels can be benchmarked on their own (test/bench/gfx_kernels.cpp).
+ */
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <stddef.h>
+
+// ----------------------------------------------------------------------------- : Kernels
+
+/// Blend a row of rgb pixels of data2 into data1 with a linearly changing fixed point (1<<16) amount
+/** Pixel x gets amount mult + x * step, clamped to [0, 1<<16] */
+void linear_blend_row(unsigned char* data1, const unsigned char* data2, int width, int mult, int step);
+
+/// data1[i] = (data1[i] * mask[i] + data2[i] * (255 - mask[i])) / 255
+void mask_blend_bytes(unsigned char* data1, const unsigned char* data2, const unsigned char* mask, size_t count);
+
+/// data[i] = data[i] * factor[i] / 255
+void multiply_bytes(unsigned char* data, const unsigned char* factor, size_t count);
+/// data[i] = data[i] * factor / 255
+void multiply_bytes(unsigned char* data, unsigned char factor, size_t count);
+
+/// data[i] = 255 - data[i]
+void invert_bytes(unsigned char* data, size_t count);
+
+/// Saturate rgb pixels, see saturate(Image&,double) for the meaning of factor (= 256 * amount)
+void saturate_pixels(unsigned char* rgb, size_t count, int factor);
+
+/// Recolor rgb pixels, the colors are rgb triples, see recolor(Image&,RGB,RGB,RGB,RGB)
+void recolor_pixels(unsigned char* rgb, size_t count, const unsigned char* cr, const unsigned char* cg, const unsigned char* cb, const unsigned char* cw);
@@ -10,6 +10,7 @@
 #include <gfx/gfx.hpp>
 #include <util/error.hpp>
 #include <gui/util.hpp> // clearDC_black
+#include <util/lru_cache.hpp>
 #if defined(__WXMSW__) && wxUSE_WXDIB
   #include <wx/msw/dib.h>
 #endif
@@ -163,6 +164,47 @@ void blur_image_alpha(Image& img) {
   }
 }
 
+// ----------------------------------------------------------------------------- : Text coverage cache
+
+bool resampled_text_cache_enabled = true;
+
+/// Cache of the coverage (alpha channel) of text drawn by draw_resampled_text
+/** Drawing text at text_scaling times the size and downsampling it is the expensive part of draw_resampled_text.
+ *  The coverage only depends on the font, text, angle, stretch, size and sub-pixel position, not on the color or blur.
+ *  The same text is drawn many times: for shadows, for every redraw of a card, and for labels that are the same on every card.
+ *
+ *  Whole runs of text are cached instead of single glyphs, so kerning and sub-pixel positioning stay the same.
+ */
+class TextCoverageCache {
+public:
+  /// Set the alpha channel of img to the cached coverage, if it is cached
+  bool find(const String& key, Image& img) {
+    shared_ptr<const vector<Byte>> alpha;
+    if (!coverage.find(key, alpha)) return false;
+    if (alpha->size() != (size_t)img.GetWidth() * img.GetHeight()) return false;
+    img.InitAlpha();
+    memcpy(img.GetAlpha(), alpha->data(), alpha->size());
+    return true;
+  }
+  void store(const String& key, const Image& img) {
+    if (!img.HasAlpha()) return;
+    size_t size = img.GetWidth() * img.GetHeight();
+    coverage.store(key, make_shared<const vector<Byte>>(img.GetAlpha(), img.GetAlpha() + size), size);
+  }
+  void clear() {
+    coverage.clear();
+  }
+private:
+  LruCache<String,shared_ptr<const vector<Byte>>> coverage{32 << 20}; ///< Bounded by the number of bytes
+};
+TextCoverageCache text_coverage_cache;
+
+void clear_text_coverage_cache() {
+  text_coverage_cache.clear();
+}
+
+// ----------------------------------------------------------------------------- : Drawing resampled text
+
 // Draw text by first drawing it using a larger font and then downsampling it
 // optionally rotated by an angle
 void draw_resampled_text(DC& dc, const RealPoint& pos, const RealRect& rect, double stretch, Radians angle, Color color, const String& text, int blur_radius, int repeat) {
@@ -175,24 +217,37 @@ void draw_resampled_text(DC& dc, const RealPoint& pos, const RealRect& rect, dou
       yi = static_cast<int>(rect.y) - blur_radius / text_scaling;
   int xsub = static_cast<int>(text_scaling * (pos.x - xi)),
       ysub = static_cast<int>(text_scaling * (pos.y - yi));
-  // draw text
-  Bitmap buffer(w * text_scaling, h * text_scaling, 24); // should be initialized to black
-  wxMemoryDC mdc;
-  mdc.SelectObject(buffer);
-  clearDC_black(mdc);
-  // now draw the text
-  mdc.SetFont(dc.GetFont());
-  mdc.SetTextForeground(*wxWHITE);
-  mdc.DrawRotatedText(text, xsub, ysub, rad_to_deg(angle));
-  // get image
-  mdc.SelectObject(wxNullBitmap);
-  // step 2. sample down
+  // size after sampling down
   double ca = fabs(cos(angle)), sa = fabs(sin(angle));
-  w += int(w * (stretch - 1) * ca); // GCC makes annoying conversion warnings if *= is used here.
-  h += int(h * (stretch - 1) * sa);
-  Image img_small(w, h, false);
+  int w_small = w + int(w * (stretch - 1) * ca);
+  int h_small = h + int(h * (stretch - 1) * sa);
+  Image img_small(w_small, h_small, false);
   fill_image(img_small, color);
-  downsample_to_alpha(buffer, img_small);
+  // is the coverage of this text cached?
+  wxFont font = dc.GetFont();
+  String key;
+  if (resampled_text_cache_enabled) {
+    key << font.GetNativeFontInfoDesc() << _('/') << font.GetPointSize()
+        << _('/') << exact_double_key(angle) << _('/') << exact_double_key(stretch)
+        << _('/') << w << _('/') << h << _('/') << w_small << _('/') << h_small << _('/') << xsub << _('/') << ysub
+        << _('\n') << text;
+  }
+  if (key.empty() || !text_coverage_cache.find(key, img_small)) {
+    // draw text
+    Bitmap buffer(w * text_scaling, h * text_scaling, 24); // should be initialized to black
+    wxMemoryDC mdc;
+    mdc.SelectObject(buffer);
+    clearDC_black(mdc);
+    // now draw the text
+    mdc.SetFont(font);
+    mdc.SetTextForeground(*wxWHITE);
+    mdc.DrawRotatedText(text, xsub, ysub, rad_to_deg(angle));
+    // get image
+    mdc.SelectObject(wxNullBitmap);
+    // step 2. sample down
+    downsample_to_alpha(buffer, img_small);
+    if (!key.empty()) text_coverage_cache.store(key, img_small);
+  }
   // multiply alpha
   if (color.Alpha() != 255) {
     set_alpha(img_small, color.Alpha() / 255.);
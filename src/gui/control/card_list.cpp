@@ -69,6 +69,7 @@ struct Freezer{
 void CardListBase::onAction(const Action& action, bool undone) {
   TYPE_CASE(action, AddCardAction) {
     Freezer freeze(this);
+    clearSortKeys();
     if (action.action.adding != undone) {
       // select the new cards
       focusNone();
@@ -90,6 +91,7 @@ void CardListBase::onAction(const Action& action, bool undone) {
     }
   }
   TYPE_CASE(action, ReorderCardsAction) {
+    clearSortKeys();
     if (sort_by_column >= 0) return; // nothing changes for us
                 if ((long)action.card_id1 < 0 || (long)action.card_id2 >= (long)sorted_list.size()) return;
     if ((long)action.card_id1 == selected_item_pos || (long)action.card_id2 == selected_item_pos) {
@@ -103,12 +105,21 @@ void CardListBase::onAction(const Action& action, bool undone) {
     RefreshItem((long)action.card_id1);
     RefreshItem((long)action.card_id2);
   }
-  TYPE_CASE_(action, ScriptValueEvent) {
+  TYPE_CASE(action, ScriptValueEvent) {
     // No refresh needed, a ScriptValueEvent is only generated in response to a ValueAction
+    if (action.card) cardChanged(action.card);
     return;
   }
   TYPE_CASE(action, ValueAction) {
-    if (action.card) refreshList(true);
+    if (action.card) {
+      cardChanged(action.card.get());
+      // when only a single card has changed, it is enough to move that card
+      bool single_card = changed_cards.size() == 1;
+      changed_cards.clear();
+      if (!single_card || !resortItem(action.card)) {
+        refreshList(true);
+      }
+    }
   }
 }
 
@@ -167,7 +178,8 @@ bool CardListBase::doPaste() {
   vector<CardP> new_cards;
   ok = data.getCards(set, new_cards);
   if (!ok) return false;
-  // add card to set
+  // add card to set, the scripts that depend on the card list are updated once at the end
+  ActionBatch batch(set->actions);
   set->actions.addAction(make_unique<AddCardAction>(ADD, *set, new_cards));
   return true;
 }
@@ -177,26 +189,54 @@ bool CardListBase::doDelete() {
   getSelection(cards_to_delete);
   if (cards_to_delete.empty()) return false;
   // delete cards
+  ActionBatch batch(set->actions);
   set->actions.addAction(make_unique<AddCardAction>(REMOVE, *set, cards_to_delete));
   return true;
 }
 
 // ----------------------------------------------------------------------------- : CardListBase : Building the list
 
+const CardListBase::SortKeys& CardListBase::getSortKeys(Card* card) const {
+  FieldP sort_field = column_fields[sort_by_column];
+  if (sort_field != sort_keys_field) {
+    // sorting by another column, the cached keys are of no use
+    sort_keys.clear();
+    sort_keys_field = sort_field;
+  }
+  auto it = sort_keys.find(card);
+  if (it != sort_keys.end()) return it->second;
+  SortKeys& keys = sort_keys[card];
+  ValueP value = card->data[sort_field];
+  assert(value);
+  keys.key = value->getSortKey();
+  if (alternate_sort_field) {
+    keys.alternate_key = card->data[alternate_sort_field]->getSortKey();
+  }
+  return keys;
+}
+
+void CardListBase::clearSortKeys() {
+  sort_keys.clear();
+  changed_cards.clear();
+}
+
+void CardListBase::cardChanged(const Card* card) {
+  sort_keys.erase(card);
+  if (find(changed_cards.begin(), changed_cards.end(), card) == changed_cards.end()) {
+    changed_cards.push_back(card);
+  }
+}
+
 // Comparison object for comparing cards
 bool CardListBase::compareItems(void* a, void* b) const {
-  FieldP sort_field = column_fields[sort_by_column];
-  ValueP va = reinterpret_cast<Card*>(a)->data[sort_field];
-  ValueP vb = reinterpret_cast<Card*>(b)->data[sort_field];
-  assert(va && vb);
+  const SortKeys& ka = getSortKeys(reinterpret_cast<Card*>(a));
+  const SortKeys& kb = getSortKeys(reinterpret_cast<Card*>(b));
   // compare sort keys
-  int cmp = smart_compare( va->getSortKey(), vb->getSortKey() );
+  int cmp = smart_compare(ka.key, kb.key);
   if (cmp != 0) return cmp < 0;
   // equal values, compare alternate sort key
   if (alternate_sort_field) {
-    ValueP va = reinterpret_cast<Card*>(a)->data[alternate_sort_field];
-    ValueP vb = reinterpret_cast<Card*>(b)->data[alternate_sort_field];
-    int cmp = smart_compare( va->getSortKey(), vb->getSortKey() );
+    int cmp = smart_compare(ka.alternate_key, kb.alternate_key);
     if (cmp != 0) return cmp < 0;
   }
   return false;
@@ -204,6 +244,7 @@ bool CardListBase::compareItems(void* a, void* b) const {
 
 void CardListBase::rebuild() {
   ClearAll();
+  clearSortKeys();
   column_fields.clear();
   selected_item_pos = -1;
   onRebuild();
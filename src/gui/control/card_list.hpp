@@ -10,6 +10,7 @@
 
 #include <util/prec.hpp>
 #include <gui/control/item_list.hpp>
+#include <unordered_map>
 #include <data/card.hpp>
 #include <data/set.hpp>
 
@@ -126,6 +127,23 @@ private:
   vector<FieldP> column_fields; ///< The field to use for each column (by column index)
   FieldP alternate_sort_field;  ///< Second field to sort by, if the column doesn't suffice
   
+  /// Sort keys of a card, for the sort field and the alternate sort field
+  struct SortKeys {
+    String key, alternate_key;
+  };
+  /// Cached sort keys, for sort_keys_field, so they are not recomputed for each comparison
+  mutable unordered_map<const Card*,SortKeys> sort_keys;
+  mutable FieldP                              sort_keys_field;
+  /// Cards whose values changed since the list was last sorted
+  vector<const Card*> changed_cards;
+  
+  /// Get the (cached) sort keys of a card
+  const SortKeys& getSortKeys(Card* card) const;
+  /// Forget all cached sort keys
+  void clearSortKeys();
+  /// The value of a card has changed, forget its sort keys
+  void cardChanged(const Card* card);
+  
   mutable wxListItemAttr item_attr; // for OnGetItemAttr
   
 public:
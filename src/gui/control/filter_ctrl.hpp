@@ -27,10 +27,11 @@ public:
   String const& getFilterString() const { return value; }
   void focusAndSelect();
   
+  /// Get a filter for the current filter string, optionally using an index to find matches
   template <typename T>
-  intrusive_ptr<Filter<T>> getFilter() const {
+  intrusive_ptr<Filter<T>> getFilter(QuickSearchIndexP const& index = QuickSearchIndexP()) const {
     if (hasFilter()) {
-      return make_intrusive<QuickFilter<T>>(getFilterString());
+      return make_intrusive<QuickFilter<T>>(getFilterString(), index);
     } else {
       return intrusive_ptr<Filter<T>>();
     }
@@ -10,6 +10,7 @@
 #include <gui/control/item_list.hpp>
 #include <gui/util.hpp>
 #include <wx/imaglist.h>
+#include <unordered_map>
 
 // ----------------------------------------------------------------------------- : ItemList
 
@@ -193,6 +194,43 @@ void ItemList::refreshList(bool refresh_current_only) {
   }
 }
 
+bool ItemList::resortItem(const VoidP& item) {
+  if (sort_by_column < 0) return false;
+  // The list should still contain the same items
+  vector<VoidP> items;
+  getItems(items);
+  if (items.size() != sorted_list.size()) return false;
+  // Equal items are kept in the order of getItems by stable_sort, do the same here
+  unordered_map<void*,size_t> order;
+  for (size_t i = 0 ; i < items.size() ; ++i) {
+    order[items[i].get()] = i;
+  }
+  if (order.find(item.get()) == order.end()) return false;
+  auto old_it = find(sorted_list.begin(), sorted_list.end(), item);
+  if (old_it == sorted_list.end()) return false;
+  long old_pos = (long)(old_it - sorted_list.begin());
+  sorted_list.erase(old_it);
+  // Find the new position
+  ItemComparer comparer(*this);
+  auto new_it = lower_bound(sorted_list.begin(), sorted_list.end(), item, [&](const VoidP& a, const VoidP& b) {
+    if (comparer(a,b)) return true;
+    if (comparer(b,a)) return false;
+    return order[a.get()] < order[b.get()];
+  });
+  long new_pos = (long)(new_it - sorted_list.begin());
+  sorted_list.insert(new_it, item);
+  // refresh
+  if (new_pos == old_pos) {
+    RefreshItem(new_pos);
+  } else {
+    findSelectedItemPos();
+    focusNone();
+    focusSelectedItem(true);
+    RefreshItems(min(old_pos, new_pos), max(old_pos, new_pos));
+  }
+  return true;
+}
+
 void ItemList::sortBy(long column, bool ascending) {
   // Change image in column header
   long count = GetColumnCount();
@@ -75,6 +75,12 @@ protected:
   virtual void sortBy(long column, bool ascending);
   /// Refresh the card list (resort, refresh and reselect current item)
   void refreshList(bool refresh_current_only = false);
+  /// Move a single item whose sort key has changed to its new position
+  /** Only the position of item is updated, the rest of the list is assumed to still be sorted.
+   *  Returns false if that is not possible because the items in the list have changed,
+   *  then refreshList should be used instead.
+   */
+  bool resortItem(const VoidP& item);
   /// Set the image of a column header (fixes wx bug)
   void SetColumnImage(int col, int image);
   
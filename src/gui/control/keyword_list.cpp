@@ -151,17 +151,14 @@ String match_string(const Keyword& a) {
 }
 
 void KeywordList::getItems(vector<VoidP>& out) const {
-  FOR_EACH(k, set->keywords) {
-    k->fixed = false;
-    if (!filter || filter->keep(*k)) {
-      out.push_back(k);
-    }
-  }
-  FOR_EACH(k, set->game->keywords) {
-    k->fixed = true;
-    if (!filter || filter->keep(*k)) {
-      out.push_back(k);
-    }
+  FOR_EACH(k, set->keywords)       k->fixed = false;
+  FOR_EACH(k, set->game->keywords) k->fixed = true;
+  if (filter) {
+    filter->getItems(set->keywords,       out);
+    filter->getItems(set->game->keywords, out);
+  } else {
+    out.insert(out.end(), set->keywords.begin(),       set->keywords.end());
+    out.insert(out.end(), set->game->keywords.begin(), set->game->keywords.end());
   }
 }
 void KeywordList::sendEvent() {
@@ -344,7 +344,7 @@ void CardsPanel::onCommand(int id) {
     }
     case ID_CARD_FILTER: {
       // card filter has changed, update the card list
-      card_list->setFilter(filter->getFilter<Card>());
+      card_list->setFilter(filter->getFilter<Card>(set->card_search_index));
       break;
     }
     default: {
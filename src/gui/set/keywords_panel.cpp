@@ -217,7 +217,7 @@ void KeywordsPanel::onCommand(int id) {
     }
     case ID_KEYWORD_FILTER: {
       // keyword filter has changed, update the list
-      list->setFilter(filter->getFilter<Keyword>());
+      list->setFilter(filter->getFilter<Keyword>(set->keyword_search_index));
       break;
     }
     default:
@@ -15,6 +15,7 @@
 #include <data/game.hpp>
 #include <data/statistics.hpp>
 #include <data/action/value.hpp>
+#include <data/action/set.hpp>
 #include <util/window_id.hpp>
 #include <util/alignment.hpp>
 #include <util/tagged_string.hpp>
@@ -337,16 +338,47 @@ void StatsPanel::onChangeSet() {
     categories->show(set->game);
   #endif
   card = CardP();
+  forgetAll();
   onChange();
 }
 
 void StatsPanel::onAction(const Action& action, bool undone) {
   if (!isInitialized()) return;
-  TYPE_CASE_(action, ScriptValueEvent) {
-    // ignore style only stuff
-  } else {
+  TYPE_CASE(action, ScriptValueEvent) {
+    // the graph is updated in response to the action that caused this
+    if (action.card) forgetCard(action.card);
+    else             forgetAll();
+    return;
+  }
+  TYPE_CASE(action, ValueAction) {
+    if (action.card) forgetCard(action.card.get());
+    else             forgetAll();
+    onChange();
+    return;
+  }
+  TYPE_CASE(action, AddCardAction) {
+    FOR_EACH_CONST(step, action.action.steps) forgetCard(step.item.get());
+    onChange();
+    return;
+  }
+  TYPE_CASE(action, ChangeCardStyleAction) {
+    forgetCard(action.card.get());
+    onChange();
+    return;
+  }
+  TYPE_CASE_(action, ReorderCardsAction) {
+    // dimensions can depend on the position of a card (with position_of or the card number)
+    forgetAll();
+    onChange();
+    return;
+  }
+  TYPE_CASE_(action, DisplayChangeAction) {
     onChange();
+    return;
   }
+  // don't know what has changed
+  forgetAll();
+  onChange();
 }
 
 void StatsPanel::initUI   (wxToolBar* tb, wxMenuBar* mb) {
@@ -476,20 +508,17 @@ void StatsPanel::showCategory(const GraphType* prefer_layout) {
   }
   // find values for each card
   for (size_t i = 0 ; i < set->cards.size() ; ++i) {
-    Context& ctx = set->getContext(set->cards[i]);
     GraphElementP e = make_intrusive<GraphElement>(i);
     bool show = true;
     FOR_EACH(dim, dims) {
-      try {
-        String value = untag(dim->script.invoke(ctx)->toString());
-        e->values.push_back(value);
-        if (value.empty() && !dim->show_empty) {
-          // don't show this element
-          show = false;
-          break;
-        }
-      } catch (ScriptError const& e) {
-        handle_error(ScriptError(e.what() + _("\n  in script for statistics dimension '") + dim->name + _("'")));
+      String value;
+      if (!dimensionValue(*dim, i, value)) {
+        show = false;
+        break;
+      }
+      e->values.push_back(value);
+      if (value.empty() && !dim->show_empty) {
+        // don't show this element
         show = false;
         break;
       }
@@ -499,6 +528,15 @@ void StatsPanel::showCategory(const GraphType* prefer_layout) {
       d.elements.push_back(e);
     }
   }
+  // if nothing has changed, keep the current graph (and the selection in it)
+  vector<pair<size_t,vector<String>>> elements;
+  elements.reserve(d.elements.size());
+  FOR_EACH(e, d.elements) elements.emplace_back(e->original_index, e->values);
+  if (dims == shown_dimensions && elements == shown_elements && layout == graph->getLayout() && graph->getData()) {
+    return;
+  }
+  shown_dimensions = dims;
+  swap(shown_elements, elements);
   // split lists
   size_t dim_id = 0;
   FOR_EACH(dim, dims) {
@@ -510,6 +548,35 @@ void StatsPanel::showCategory(const GraphType* prefer_layout) {
   graph->setData(d);
   filterCards();
 }
+bool StatsPanel::dimensionValue(const StatsDimension& dim, size_t card_index, String& out) {
+  const CardP& card = set->cards[card_index];
+  unordered_map<const Card*,String>& values = dimension_values[&dim];
+  auto it = values.find(card.get());
+  if (it != values.end()) {
+    out = it->second;
+    return true;
+  }
+  try {
+    Context& ctx = set->getContext(card);
+    out = untag(dim.script.invoke(ctx)->toString());
+    values.emplace(card.get(), out);
+    return true;
+  } catch (ScriptError const& e) {
+    handle_error(ScriptError(e.what() + _("\n  in script for statistics dimension '") + dim.name + _("'")));
+    return false;
+  }
+}
+
+void StatsPanel::forgetCard(const Card* card) {
+  FOR_EACH(v, dimension_values) v.second.erase(card);
+}
+
+void StatsPanel::forgetAll() {
+  dimension_values.clear();
+  shown_dimensions.clear();
+  shown_elements.clear();
+}
+
 void StatsPanel::showLayout(GraphType layout) {
   #if USE_DIMENSION_LISTS && !USE_SEPARATE_DIMENSION_LISTS
     // make sure we have the right number of data dimensions
@@ -11,11 +11,13 @@
 #include <util/prec.hpp>
 #include <gui/set/panel.hpp>
 #include <data/graph_type.hpp>
+#include <unordered_map>
 
 class StatCategoryList;
 class StatDimensionList;
 class GraphControl;
 class FilteredCardList;
+DECLARE_POINTER_TYPE(StatsDimension);
 
 // Pick the style here:
 #define USE_DIMENSION_LISTS 1
@@ -63,8 +65,22 @@ private:
   bool up_to_date; ///< Are the graph and card list up to date?
   bool active;     ///< Is this panel selected?
   
+  /// Values of the dimensions for each card, so only cards that change have to be evaluated again
+  /** Dimension scripts are assumed to only look at the card, at the set, and at the order of the cards. */
+  map<const StatsDimension*, unordered_map<const Card*,String>> dimension_values;
+  /// The data that is currently shown in the graph
+  vector<StatsDimensionP>             shown_dimensions;
+  vector<pair<size_t,vector<String>>> shown_elements; ///< Index and dimension values of each shown card
+  
   void initControls();
   
+  /// Get the value of a dimension for a card, returns false on error
+  bool dimensionValue(const StatsDimension& dim, size_t card_index, String& out);
+  /// The values of a card might have changed
+  void forgetCard(const Card* card);
+  /// The values of all cards might have changed
+  void forgetAll();
+  
   void onChange();
   void onGraphSelect(wxCommandEvent&);
   void showCategory(const GraphType* prefer_layout = nullptr);
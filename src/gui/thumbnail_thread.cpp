@@ -8,19 +8,13 @@
 
 #include <util/prec.hpp>
 #include <gui/thumbnail_thread.hpp>
+#include <gfx/image_cache.hpp>
 #include <util/platform.hpp>
 #include <util/error.hpp>
 #include <wx/thread.h>
 
 // ----------------------------------------------------------------------------- : Image Cache
 
-String user_settings_dir();
-String image_cache_dir() {
-  String dir = user_settings_dir() + _("/cache");
-  if (!wxDirExists(dir)) wxMkdir(dir);
-  return dir + _("/");
-}
-
 /// A name that is safe to use as a filename, for the cache
 String safe_filename(const String& str) {
   String ret; ret.reserve(str.size());
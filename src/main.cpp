@@ -9,6 +9,8 @@
 #include <util/prec.hpp>
 #include <util/io/package_manager.hpp>
 #include <util/spell_checker.hpp>
+#include <util/trace.hpp>
+#include <script/parser.hpp>
 #include <data/game.hpp>
 #include <data/set.hpp>
 #include <data/settings.hpp>
@@ -17,12 +19,15 @@
 #include <data/format/formats.hpp>
 #include <cli/cli_main.hpp>
 #include <cli/text_io_handler.hpp>
+#include <cli/bench.hpp>
+#include <cli/server.hpp>
 #include <gui/welcome_window.hpp>
 #include <gui/update_checker.hpp>
 #include <gui/packages_window.hpp>
 #include <gui/set/window.hpp>
 #include <gui/symbol/window.hpp>
 #include <gui/thumbnail_thread.hpp>
+#include <gfx/image_cache.hpp>
 #include <wx/fs_inet.h>
 #include <wx/wfstream.h>
 #include <wx/txtstrm.h>
@@ -60,6 +65,9 @@ public:
 
 IMPLEMENT_APP(MSE)
 
+/// File to write a trace to on exit, given with --trace
+String trace_filename;
+
 // ----------------------------------------------------------------------------- : Checks
 
 void nag_about_ascii_version() {
@@ -102,8 +110,28 @@ int MSE::OnRun() {
       // ingnore the --color argument, it is handled by cli.init()
       vector<String> args;
       for (int i = 1; i < argc; ++i) {
-        args.push_back(argv[i]);
-        if (args.back() == _("--color")) args.pop_back();
+        String arg = argv[i];
+        if (arg == _("--color")) continue;
+        // --trace can be combined with any other option
+        if (arg == _("--trace")) {
+          if (i + 1 >= argc) {
+            handle_error(Error(_("No output file specified for --trace")));
+            return EXIT_FAILURE;
+          }
+          trace_filename = argv[++i];
+          trace_start();
+          continue;
+        }
+        // --packages can be combined with any other option
+        if (arg == _("--packages")) {
+          if (i + 1 >= argc) {
+            handle_error(Error(_("No directory specified for --packages")));
+            return EXIT_FAILURE;
+          }
+          package_manager.setLocalDirectory(argv[++i]);
+          continue;
+        }
+        args.push_back(arg);
       }
       if (!args.empty()) {
         const String& arg = args[0];
@@ -132,8 +160,10 @@ int MSE::OnRun() {
           wnd.ShowModal();
           return EXIT_SUCCESS;
         } else if (f.GetExt() == _("mse-script")) {
-          // Run a script file
-          if (!run_script_file(arg)) return EXIT_FAILURE;
+          // Run a script file, optionally with a set
+          SetP set;
+          if (args.size() > 1) set = import_set(args[1]);
+          if (!run_script_file(arg, set)) return EXIT_FAILURE;
           if (cli.shown_errors()) return EXIT_FAILURE;
           return EXIT_SUCCESS;
         } else if (arg == _("--symbol-editor")) {
@@ -176,8 +206,13 @@ int MSE::OnRun() {
                              << NORMAL << _(" [") << BRIGHT << _("--local") << NORMAL << _("]");
           cli << _("\n         \tInstall the packages from the installer.");
           cli << _("\n         \tIf the ") << BRIGHT << _("--local") << NORMAL << _(" flag is passed, install packages for this user only.");
-          cli << _("\n\n  ") << PARAM << _("FILE") << FILE_EXT << _(".mse-script") << NORMAL;
-          cli << _("\n         \tRun a script file.");
+          cli << _("\n\n  ") << PARAM << _("FILE") << FILE_EXT << _(".mse-script") << NORMAL << _(" [")
+                             << PARAM << _("SETFILE") << NORMAL << _("]");
+          cli << _("\n         \tRun a script file, in the context of the set if SETFILE is given.");
+          cli << _("\n         \tWith a set, the script can change it with ") << BRIGHT << _("change_value") << NORMAL << _(", ")
+              << BRIGHT << _("swap_cards") << NORMAL << _(", ") << BRIGHT << _("add_cards") << NORMAL
+              << _(" and ") << BRIGHT << _("action_batch") << NORMAL << _(", and save it with ")
+              << BRIGHT << _("save_set") << NORMAL << _(" and ") << BRIGHT << _("save_set_as") << NORMAL << _(".");
           cli << _("\n\n  ") << BRIGHT << _("--symbol-editor") << NORMAL;
           cli << _("\n         \tShow the symbol editor instead of the welcome window.");
           cli << _("\n\n  ") << BRIGHT << _("--create-installer") << NORMAL << _(" [")
@@ -188,9 +223,11 @@ int MSE::OnRun() {
           cli << _("\n\n  ") << BRIGHT << _("--export") << NORMAL << PARAM << _(" TEMPLATE SETFILE ") << NORMAL << _(" [") << PARAM << _("OUTFILE") << NORMAL << _("]");
           cli << _("\n         \tExport a set using an export template.");
           cli << _("\n         \tIf no output filename is specified, the result is written to stdout.");
-          cli << _("\n\n  ") << BRIGHT << _("--export-images") << NORMAL << PARAM << _(" FILE") << NORMAL << _(" [") << PARAM << _("IMAGE") << NORMAL << _("]");
+          cli << _("\n\n  ") << BRIGHT << _("--export-images") << NORMAL << PARAM << _(" FILE") << NORMAL << _(" [") << PARAM << _("IMAGE") << NORMAL << _("] [")
+                             << BRIGHT << _("--jobs") << NORMAL << PARAM << _(" N") << NORMAL << _("]");
           cli << _("\n         \tExport the cards in a set to image files,");
           cli << _("\n         \tIMAGE is the same format as for 'export all card images'.");
+          cli << _("\n         \tUse ") << BRIGHT << _("--jobs") << NORMAL << PARAM << _(" N") << NORMAL << _(" to write the images using N threads.");
           cli << _("\n\n  ") << BRIGHT << _("--cli") << NORMAL << _(" [")
                              << PARAM << _("FILE") << NORMAL << _("] [")
                              << BRIGHT << _("--quiet") << NORMAL << _("] [")
@@ -198,6 +235,25 @@ int MSE::OnRun() {
           cli << _("\n         \tStart the command line interface for performing commands on the set file.");
           cli << _("\n         \tUse ") << BRIGHT << _("-q") << NORMAL << _(" or ") << BRIGHT << _("--quiet") << NORMAL << _(" to supress the startup banner and prompts.");
           cli << _("\n         \tUse ") << BRIGHT << _("-raw") << NORMAL << _(" for raw output mode.");
+          cli << _("\n\n  ") << BRIGHT << _("--server") << NORMAL;
+          cli << _("\n         \tHandle requests from another program: load sets, evaluate scripts, render and export cards.");
+          cli << _("\n         \tRequests are read from stdin as JSON objects, one per line, for example");
+          cli << _("\n         \t  {\"id\":1, \"command\":\"load\", \"set\":\"a\", \"file\":\"my.mse-set\"}");
+          cli << _("\n         \t  {\"id\":2, \"command\":\"eval\", \"set\":\"a\", \"card\":0, \"script\":\"card.name\"}");
+          cli << _("\n         \tThe other commands are unload, sets, render (set, card, file), export (set, template, file) and quit.");
+          cli << _("\n         \tFor each request a JSON object with the same id is written to stdout, on one line.");
+          cli << _("\n\n  ") << BRIGHT << _("--bench") << NORMAL << PARAM << _(" DIR") << NORMAL << _(" [")
+                             << BRIGHT << _("--cards") << NORMAL << PARAM << _(" N") << NORMAL << _("] [")
+                             << BRIGHT << _("--repeat") << NORMAL << PARAM << _(" N") << NORMAL << _("] [")
+                             << BRIGHT << _("--output") << NORMAL << PARAM << _(" FILE") << NORMAL << _("]");
+          cli << _("\n         \tMeasure saving, loading, script updates, keyword expansion, text layout and rendering");
+          cli << _("\n         \tof a generated set of N cards, using the benchmark packages in DIR (test/bench/data).");
+          cli << _("\n         \tThe results are written to FILE or stdout as JSON, one line per benchmark.");
+          cli << _("\n\n  ") << BRIGHT << _("--trace") << NORMAL << PARAM << _(" FILE") << NORMAL;
+          cli << _("\n         \tRecord the time spent rendering, running scripts, reading packages and generating images,");
+          cli << _("\n         \tand write it to FILE on exit, as a Chrome trace (JSON). Can be combined with the other options.");
+          cli << _("\n\n  ") << BRIGHT << _("--packages") << NORMAL << PARAM << _(" DIR") << NORMAL;
+          cli << _("\n         \tLook for packages in DIR instead of the user's data directory. Can be combined with the other options.");
           cli << _("\n\nRaw output mode is intended for use by other programs:");
           cli << _("\n    - The only output is only in response to commands.");
           cli << _("\n    - For each command a single 'record' is written to the standard output.");
@@ -237,11 +293,30 @@ int MSE::OnRun() {
             handle_error(Error(_("No input file specified for --export")));
             return EXIT_FAILURE;
           }
+          // options
+          long jobs = 1;
+          String out;
+          for (size_t i = 2 ; i < args.size() ; ++i) {
+            if (args[i] == _("--jobs")) {
+              if (i + 1 >= args.size()) {
+                handle_error(Error(_("No number of jobs specified for --jobs")));
+                return EXIT_FAILURE;
+              }
+              if (!args[i+1].ToLong(&jobs) || jobs < 1) {
+                handle_error(Error(_("Invalid number of jobs for --jobs: ") + args[i+1]));
+                return EXIT_FAILURE;
+              }
+              ++i;
+            } else if (out.empty()) {
+              out = args[i];
+            } else {
+              handle_error(Error(_("Unexpected argument for --export-images: ") + args[i]));
+              return EXIT_FAILURE;
+            }
+          }
           SetP set = import_set(args[1]);
           // path
-          String out = args.size() >= 3 && !starts_with(args[2], _("--"))
-            ? args[2]
-            : settings.gameSettingsFor(*set->game).images_export_filename;
+          if (out.empty()) out = settings.gameSettingsFor(*set->game).images_export_filename;
           String path = _(".");
           size_t pos = out.find_last_of(_("/\\"));
           if (pos != String::npos) {
@@ -251,7 +326,15 @@ int MSE::OnRun() {
             out = out.substr(pos + 1);
           }
           // export
-          export_images(set, set->cards, path, out, CONFLICT_NUMBER_OVERWRITE);
+          export_images(set, set->cards, path, out, CONFLICT_NUMBER_OVERWRITE, (int)jobs);
+          return EXIT_SUCCESS;
+        } else if (arg == _("--server")) {
+          // requests from other programs
+          ScriptServer server;
+          server.run();
+          return EXIT_SUCCESS;
+        } else if (arg == _("--bench")) {
+          run_benchmarks(vector<String>(args.begin() + 1, args.end()));
           return EXIT_SUCCESS;
         } else if (args[0] == _("--export")) {
           if (args.size() < 2) {
@@ -292,8 +375,18 @@ int MSE::runGUI() {
 
 int MSE::OnExit() {
   thumbnail_thread.abortAll();
+  generated_image_cache.flush();
+  if (!trace_filename.empty()) {
+    trace_stop();
+    try {
+      trace_save(trace_filename);
+    } catch (const Error& e) {
+      cli.show_message(MESSAGE_ERROR, e.what());
+    }
+  }
   settings.write();
   package_manager.destroy();
+  clear_parse_cache();
   SpellChecker::destroyAll();
   return 0;
 }
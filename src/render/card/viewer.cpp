@@ -16,6 +16,7 @@
 #include <data/settings.hpp>
 #include <data/action/value.hpp>
 #include <data/action/set.hpp>
+#include <util/trace.hpp>
 #include <gui/util.hpp> // clearDC
 
 // ----------------------------------------------------------------------------- : DataViewer
@@ -35,6 +36,7 @@ void DataViewer::draw(DC& dc) {
 }
 void DataViewer::draw(RotatedDC& dc, const Color& background) {
   if (!set) return; // no set specified, don't draw anything
+  TRACE_SCOPE("render", "draw card");
   WITH_DYNAMIC_ARG(drawing_card, true);
   // fill with background color
   clearDC(dc.getDC(), background);
@@ -45,6 +47,7 @@ void DataViewer::draw(RotatedDC& dc, const Color& background) {
   FOR_EACH(v, viewers) { // draw low z index fields first
     if (v->isVisible()) {
       Rotater r(dc, v->getRotation());
+      TRACE_SCOPE("render", "prepare viewer", v->getField()->name);
       try {
         if (v->prepare(dc)) {
           changed_content_properties = true;
@@ -61,6 +64,7 @@ void DataViewer::draw(RotatedDC& dc, const Color& background) {
   FOR_EACH(v, viewers) { // draw low z index fields first
     if (v->isVisible()) {// visible
       Rotater r(dc, v->getRotation());
+      TRACE_SCOPE("render", "draw viewer", v->getField()->name);
       try {
         drawViewer(dc, *v);
       } catch (const Error& e) {
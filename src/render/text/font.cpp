@@ -28,22 +28,28 @@ void FontTextElement::getCharInfo(RotatedDC& dc, double scale, vector<CharInfo>&
   // font
   dc.SetFont(*font, scale);
   // find sizes & breaks
-  double prev_width = 0;
+  // each line is measured at once, the width of a character is the difference between the widths of two prefixes
+  vector<double> widths;
   size_t line_start = start; // start of the current line
-  for (size_t i = start ; i < end ; ++i) {
-    Char c = content.GetChar(i - this->start);
-    if (c == _('\n')) {
+  for (size_t i = start ; i <= end ; ++i) {
+    if (i < end && content.GetChar(i - this->start) != _('\n')) continue;
+    if (i > line_start) {
+      RealSize s = dc.GetPartialTextExtents(content.substr(line_start - this->start, i - line_start), widths);
+      double prev_width = 0;
+      for (size_t j = line_start ; j < i ; ++j) {
+        double width = j - line_start < widths.size() ? widths[j - line_start] : prev_width;
+        out.push_back(CharInfo(
+                         RealSize(width - prev_width, s.height),
+                         content.GetChar(j - this->start) == _(' ') ? LineBreak::SPACE : LineBreak::MAYBE,
+                         draw_as == DRAW_ACTIVE // from <soft> tag
+                     ));
+        prev_width = width;
+      }
+    }
+    if (i < end) {
+      // newline
       out.push_back(CharInfo(RealSize(0, dc.GetCharHeight()), break_style, draw_as == DRAW_ACTIVE));
       line_start = i + 1;
-      prev_width = 0;
-    } else {
-      RealSize s = dc.GetTextExtent(content.substr(line_start - this->start, i - line_start + 1));
-      out.push_back(CharInfo(
-                       RealSize(s.width - prev_width, s.height),
-                       c == _(' ') ? LineBreak::SPACE : LineBreak::MAYBE,
-                       draw_as == DRAW_ACTIVE // from <soft> tag
-                   ));
-      prev_width = s.width;
     }
   }
 }
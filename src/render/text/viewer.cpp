@@ -9,6 +9,8 @@
 #include <util/prec.hpp>
 #include <render/text/viewer.hpp>
 #include <algorithm>
+#include <util/lru_cache.hpp>
+#include <util/trace.hpp>
 
 // ----------------------------------------------------------------------------- : Line
 
@@ -156,6 +158,7 @@ void TextViewer::drawSeparators(RotatedDC& dc) {
 bool TextViewer::prepare(RotatedDC& dc, const String& text, TextStyle& style, Context& ctx) {
   if (!prepared()) {
     // not prepared yet
+    TRACE_SCOPE("render", "prepare text");
     prepareElements(text, style, ctx);
     prepareLines(dc, text, style, ctx);
     return true;
@@ -389,9 +392,83 @@ TextLayoutP TextViewer::extractLayoutInfo() const {
   return layout;
 }
 
+// ----------------------------------------------------------------------------- : Layout : fitting
+
+/// Layouts found by TextViewer::prepareLinesTryScales, by text, style and box
+/** Finding the scale for text that has to be scaled down to fit takes several layout attempts.
+ *  The same text is often layed out again in the same style and box:
+ *  when switching between cards, when redrawing, and when exporting.
+ *  The memo is bounded by the approximate number of bytes used.
+ */
+class TextFitMemo {
+public:
+  bool find(const String& key, double& scale, vector<TextViewer::Line>& lines, vector<CharInfo>& chars) {
+    shared_ptr<const Fit> fit;
+    if (!fits.find(key, fit)) return false;
+    scale = fit->scale;
+    lines = fit->lines;
+    chars = fit->chars;
+    return true;
+  }
+  void store(const String& key, double scale, const vector<TextViewer::Line>& lines, const vector<CharInfo>& chars) {
+    size_t bytes = sizeof(Fit) + key.size() * sizeof(Char)
+                 + lines.size() * sizeof(TextViewer::Line) + chars.size() * (sizeof(CharInfo) + sizeof(double)); // and the positions in lines
+    fits.store(key, make_shared<const Fit>(Fit{scale, lines, chars}), bytes);
+  }
+  void clear() {
+    fits.clear();
+  }
+private:
+  struct Fit {
+    double                   scale;
+    vector<TextViewer::Line> lines;
+    vector<CharInfo>         chars;
+  };
+  LruCache<String,shared_ptr<const Fit>> fits{32 << 20};
+};
+TextFitMemo text_fit_memo;
+
+void TextViewer::clearLayoutMemo() {
+  text_fit_memo.clear();
+}
+
+/// Key for the TextFitMemo, everything that influences the layout
+/** Returns an empty string if the layout should not be memoized */
+String text_fit_key(RotatedDC& dc, const String& text, const TextStyle& style) {
+  // masks change the width of lines, we don't have a good key for them
+  if (style.mask.getFromCache().isLoaded()) return String();
+  RealSize box = dc.getInternalSize();
+  const Font& font = style.font;
+  const SymbolFontRef& symbol_font = style.symbol_font;
+  // doubles are included exactly, layouts can differ for sizes that round to the same few digits
+  auto d = exact_double_key;
+  String key;
+  key << d(box.width) << _(' ') << d(box.height) << _(' ') << d(dc.getZoom()) << _(' ') << d(dc.getStretch()) << _(' ') << (int)dc.getQuality()
+      << _('|') << font.name() << _('|') << font.italic_name() << _('|') << d(font.size()) << _(' ') << font.weight() << _(' ') << font.style()
+      << _(' ') << (int)font.underline() << _(' ') << font.flags << _(' ') << d(font.scale_down_to) << _(' ') << d(font.max_stretch)
+      << _('|') << symbol_font.name() << _('|') << d(symbol_font.size()) << _(' ') << d(symbol_font.scale_down_to) << _(' ') << (int)symbol_font.alignment()
+      << _('|') << (int)style.always_symbol << _(' ') << (int)style.allow_formating << _(' ') << (int)style.alignment() << _(' ') << (int)style.direction
+      << _(' ') << (int)style.field().multi_line
+      << _(' ') << d(style.padding_left())   << _(' ') << d(style.padding_left_min())
+      << _(' ') << d(style.padding_right())  << _(' ') << d(style.padding_right_min())
+      << _(' ') << d(style.padding_top())    << _(' ') << d(style.padding_top_min())
+      << _(' ') << d(style.padding_bottom()) << _(' ') << d(style.padding_bottom_min())
+      << _(' ') << d(style.line_height_soft()) << _(' ') << d(style.line_height_soft_max())
+      << _(' ') << d(style.line_height_hard()) << _(' ') << d(style.line_height_hard_max())
+      << _(' ') << d(style.line_height_line()) << _(' ') << d(style.line_height_line_max())
+      << _(' ') << d(style.paragraph_height())
+      << _('\n') << text;
+  return key;
+}
+
 void TextViewer::prepareLines(RotatedDC& dc, const String& text, TextStyle& style, Context& ctx) {
   vector<CharInfo> chars;
-  prepareLinesTryScales(dc, text, style, chars);
+  // only text that can be scaled down needs multiple attempts to layout, so only that is memoized
+  String fit_key = elements.minScale() < 1.0 ? text_fit_key(dc, text, style) : String();
+  if (fit_key.empty() || !text_fit_memo.find(fit_key, scale, lines, chars)) {
+    prepareLinesTryScales(dc, text, style, chars);
+    if (!fit_key.empty()) text_fit_memo.store(fit_key, scale, lines, chars);
+  }
   assert(!lines.empty());
   
   // no text, find a dummy height for the single line we have
@@ -554,7 +631,10 @@ RealSize TextViewer::fitLineWidth(Line& line, RotatedDC& dc, const TextStyle& st
   return line_size;
 }
 
+atomic<size_t> TextViewer::layout_attempts(0);
+
 bool TextViewer::prepareLinesAtScale(RotatedDC& dc, const vector<CharInfo>& chars, const TextStyle& style, bool stop_if_too_long, vector<Line>& lines) const {
+  ++layout_attempts;
   // Try to layout the text at the current scale
   lines.clear();
 
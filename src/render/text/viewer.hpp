@@ -116,6 +116,14 @@ public:
   /// Set exact scroll position
   void setExactScrollPosition(double pos);
   
+  // --------------------------------------------------- : Statistics
+  
+  /// Number of times text has been layed out at some scale, by all TextViewers
+  /** For measuring how much work finding the scale of text is */
+  static size_t layoutAttempts() { return layout_attempts; }
+  /// Forget the memoized layouts of text that was scaled down to fit, for benchmarks
+  static void clearLayoutMemo();
+  
 private:
   /// Scroll all lines a given amount
   void scrollBy(double delta);
@@ -133,6 +141,8 @@ private:
   // --------------------------------------------------- : Lines
   vector<Line> lines; ///< The lines in the text box
   
+  static atomic<size_t> layout_attempts;
+  
   /// Prepare the lines, layout the text
   void prepareLines(RotatedDC& dc, const String& text, TextStyle& style, Context& ctx);
   /// Find the scale to use for the text
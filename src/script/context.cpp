@@ -109,7 +109,7 @@ ScriptValueP Context::eval(const Script& script, bool useScope) {
         
         // Get an object member
         case I_MEMBER_C: {
-          stack.back() = stack.back()->getMember(script.constants[i.data]->toString());
+          stack.back() = stack.back()->getMemberCached(script.constants[i.data]->toString(), script.member_caches[i.data]);
           break;
         }
         // Loop over a container, push next value or jump
@@ -117,7 +117,7 @@ ScriptValueP Context::eval(const Script& script, bool useScope) {
           ScriptValueP& it = stack[stack.size() - 2]; // second element of stack
           ScriptValueP val = it->next();
           if (val) {
-            stack.push_back(val);
+            stack.push_back(move(val));
           } else {
             stack.erase(stack.end() - 2); // remove iterator
             instr = &script.instructions[0] + i.data;
@@ -204,24 +204,24 @@ ScriptValueP Context::eval(const Script& script, bool useScope) {
         }
         // Simple instruction: binary
         case I_BINARY: {
-          ScriptValueP  b = stack.back(); stack.pop_back();
+          ScriptValueP  b = move(stack.back()); stack.pop_back();
           ScriptValueP& a = stack.back();
           instrBinary(i.instr2, a, b);
           break;
         }
         // Simple instruction: ternary
         case I_TERNARY: {
-          ScriptValueP  c = stack.back(); stack.pop_back();
-          ScriptValueP  b = stack.back(); stack.pop_back();
+          ScriptValueP  c = move(stack.back()); stack.pop_back();
+          ScriptValueP  b = move(stack.back()); stack.pop_back();
           ScriptValueP& a = stack.back();
           instrTernary(i.instr3, a, b, c);
           break;
         }
         // Simple instruction: quaternary
         case I_QUATERNARY: {
-          ScriptValueP  d = stack.back(); stack.pop_back();
-          ScriptValueP  c = stack.back(); stack.pop_back();
-          ScriptValueP  b = stack.back(); stack.pop_back();
+          ScriptValueP  d = move(stack.back()); stack.pop_back();
+          ScriptValueP  c = move(stack.back()); stack.pop_back();
+          ScriptValueP  b = move(stack.back()); stack.pop_back();
           ScriptValueP& a = stack.back();
           instrQuaternary(i.instr4, a, b, c, d);
           break;
@@ -244,7 +244,7 @@ ScriptValueP Context::eval(const Script& script, bool useScope) {
     // restore shadowed variables
     if (useScope) closeScope(scope);
     // return top of stack
-    ScriptValueP result = stack.back();
+    ScriptValueP result = move(stack.back());
     stack.pop_back();
     assert(stack.size() == stack_size); // we end up with the same stack
     return result;
@@ -21,6 +21,7 @@ enum DependencyType
 ,  DEP_EXTRA_CARD_FIELD  ///< dependency of a script in an extra stylesheet specific card field
 ,  DEP_CARD_COPY_DEP    ///< copy the dependencies from a card field
 ,  DEP_SET_COPY_DEP    ///< copy the dependencies from a set  field
+,  DEP_ORDER_CACHE    ///< the order of cards used by position_of and length, see Set::invalidateOrderCache
 ,  DEP_DUMMY        ///< used for other purposes, index and data can be anything
               //   in particular, this is used for determining /if/ there are dependencies
 };
@@ -542,10 +542,12 @@ SCRIPT_FUNCTION_DEPENDENCIES(position_of) {
     if (order_by) {
       // dependency on order_by function
       order_by->dependencies(ctx, dep.makeCardIndependend());
+      order_by->dependencies(ctx, Dependency(DEP_ORDER_CACHE, 0));
     }
     if (filter && filter != script_nil) {
       // dependency on filter function
       filter->dependencies(ctx, dep.makeCardIndependend());
+      filter->dependencies(ctx, Dependency(DEP_ORDER_CACHE, 0));
     }
   }
   return dependency_dummy;
@@ -561,14 +563,33 @@ int script_length_of(Context& ctx, const ScriptValueP& collection) {
     return collection->itemCount();
   }
 }
-SCRIPT_FUNCTION(length) {
+ScriptValueP script_length_of_dependencies(Context& ctx, const ScriptValueP& collection, const Dependency& dep) {
+  if (ScriptObject<Set*>* setobj = dynamic_cast<ScriptObject<Set*>*>(collection.get())) {
+    // dependency on cards
+    mark_dependency_member(*setobj->getValue(), _("cards"), dep);
+    ScriptValueP filter = ctx.getVariableOpt(_("filter"));
+    if (filter && filter != script_nil) {
+      // dependency on filter function
+      filter->dependencies(ctx, dep.makeCardIndependend());
+      filter->dependencies(ctx, Dependency(DEP_ORDER_CACHE, 0));
+    }
+  }
+  return dependency_dummy;
+}
+SCRIPT_FUNCTION_WITH_DEP(length) {
   SCRIPT_PARAM_C(ScriptValueP, input);
   SCRIPT_RETURN(script_length_of(ctx, input));
 }
-SCRIPT_FUNCTION(number_of_items) {
+SCRIPT_FUNCTION_DEPENDENCIES(length) {
+  return script_length_of_dependencies(ctx, ctx.getVariable(SCRIPT_VAR_input), dep);
+}
+SCRIPT_FUNCTION_WITH_DEP(number_of_items) {
   SCRIPT_PARAM_C(ScriptValueP, in);
   SCRIPT_RETURN(script_length_of(ctx, in));
 }
+SCRIPT_FUNCTION_DEPENDENCIES(number_of_items) {
+  return script_length_of_dependencies(ctx, ctx.getVariable(_("in")), dep);
+}
 
 // filtering items from a list
 SCRIPT_FUNCTION(filter_list) {
@@ -664,13 +685,7 @@ SCRIPT_FUNCTION_WITH_DEP(expand_keywords) {
   SCRIPT_OPTIONAL_PARAM_N_(ScriptValueP, _("condition"), match_condition);
   SCRIPT_OPTIONAL_PARAM_(ScriptValueP, default_expand);
   SCRIPT_PARAM(ScriptValueP, combine);
-  KeywordDatabase& db = set->keyword_db;
-  if (db.empty()) {
-    db.prepare_parameters(set->game->keyword_parameter_types, set->keywords);
-    db.prepare_parameters(set->game->keyword_parameter_types, set->game->keywords);
-    db.add(set->keywords);
-    db.add(set->game->keywords);
-  }
+  KeywordDatabase& db = set->keywordDatabase();
   SCRIPT_OPTIONAL_PARAM_C_(CardP, card);
   try {
     KeywordUsageStatistics* stat = card ? &card->keyword_usage : nullptr;
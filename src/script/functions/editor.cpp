@@ -82,7 +82,8 @@ SCRIPT_FUNCTION_WITH_DEP(combined_editor) {
       v->value.assign(nv.first);
       changed |= v->update(ctx);
       v->last_update = new_value_update;
-      if (changed) { // notify of change
+      if (changed && wxThread::IsMain()) { // notify of change
+        // note: when cards are updated on worker threads (while loading a set), there is nobody to notify
         SCRIPT_OPTIONAL_PARAM_(CardP, card);
         SCRIPT_PARAM(Set*, set);
         ScriptValueEvent change(card.get(), v);
@@ -415,7 +415,8 @@ SCRIPT_FUNCTION(write_image_file) {
   Image image;
   GeneratedImage::Options options(width, height, ei.export_template.get(), ei.set.get());
   if (card) {
-    image = conform_image(export_bitmap(ei.set, card->getValue()).ConvertToImage(), options);
+    if (!ei.card_renderer) ei.card_renderer = make_shared<CardImageRenderer>(ei.set);
+    image = conform_image(ei.card_renderer->render(card->getValue()), options);
   } else {
     image = input->toImage()->generateConform(options);
   }
@@ -55,6 +55,9 @@ bool isWordChar(wxUniChar c) {
 }
 
 SCRIPT_FUNCTION(check_spelling) {
+  // the spell checkers and settings are shared, cards can be updated on multiple threads
+  static wxMutex mutex;
+  wxMutexLocker lock(mutex);
   SCRIPT_PARAM_C(StyleSheetP,stylesheet);
   SCRIPT_PARAM_C(String,language);
   SCRIPT_PARAM_C(String,input);
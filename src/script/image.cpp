@@ -12,7 +12,9 @@
 #include <script/to_value.hpp>
 #include <util/dynamic_arg.hpp>
 #include <util/io/package.hpp>
+#include <util/trace.hpp>
 #include <gfx/generated_image.hpp>
+#include <gfx/image_cache.hpp>
 #include <data/field/image.hpp>
 
 // ----------------------------------------------------------------------------- : ScriptableImage
@@ -133,11 +135,12 @@ void CachedScriptableImage::generateCached(const GeneratedImage::Options& option
       }
     }
   }
+  TRACE_SCOPE("image", "generate cached image");
   // hack(part1): temporarily set angle to 0, do actual rotation after applying mask
   Radians a = options.angle;
   const_cast<GeneratedImage::Options&>(options).angle = 0;
-  // generate
-  cached_i = generate(options);
+  // generate, or get it from the cache shared between cards
+  cached_i = generated_image_cache.generate(*value, options);
   assert(cached_i.Ok());
   const_cast<GeneratedImage::Options&>(options).angle = cached_angle = a;
   *size = cached_size = RealSize(options.width, options.height);
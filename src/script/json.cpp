@@ -0,0 +1,289 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <util/error.hpp>
+#include <script/json.hpp>
+#include <script/value.hpp>
+#include <script/to_value.hpp>
+#include <climits>
+#include <cmath>
+
+// ----------------------------------------------------------------------------- : Reading
+
+/// Parser for JSON text, produces script values
+class JsonReader {
+public:
+  JsonReader(const String& text) : text(text), pos(0) {}
+
+  ScriptValueP readDocument() {
+    ScriptValueP value = readValue();
+    skipWhitespace();
+    if (pos < text.size()) fail(_("unexpected text after the value"));
+    return value;
+  }
+
+private:
+  const String& text;
+  size_t pos;
+
+  wxUniChar peek() const {
+    return pos < text.size() ? text.GetChar(pos) : wxUniChar(0);
+  }
+  void fail(const String& what) {
+    throw ParseError(String::Format(_("Invalid JSON at position %d: "), (int)pos) + what);
+  }
+  void skipWhitespace() {
+    while (pos < text.size()) {
+      wxUniChar c = text.GetChar(pos);
+      if (c != _(' ') && c != _('\t') && c != _('\n') && c != _('\r')) break;
+      ++pos;
+    }
+  }
+  void expect(wxUniChar c) {
+    skipWhitespace();
+    if (peek() != c) fail(String(_("expected '")) + c + _("'"));
+    ++pos;
+  }
+  bool readWord(const Char* word) {
+    size_t len = wxStrlen(word);
+    if (text.compare(pos, len, word) != 0) return false;
+    pos += len;
+    return true;
+  }
+
+  ScriptValueP readValue() {
+    skipWhitespace();
+    wxUniChar c = peek();
+    if (c == _('{')) {
+      ++pos;
+      ScriptCustomCollectionP col = make_intrusive<ScriptCustomCollection>();
+      skipWhitespace();
+      if (peek() == _('}')) {
+        ++pos;
+        return col;
+      }
+      while (true) {
+        skipWhitespace();
+        if (peek() != _('"')) fail(_("expected a string key"));
+        String key = readString();
+        expect(_(':'));
+        col->key_value[key] = readValue();
+        skipWhitespace();
+        if (peek() == _(',')) {
+          ++pos;
+        } else {
+          expect(_('}'));
+          return col;
+        }
+      }
+    } else if (c == _('[')) {
+      ++pos;
+      ScriptCustomCollectionP col = make_intrusive<ScriptCustomCollection>();
+      skipWhitespace();
+      if (peek() == _(']')) {
+        ++pos;
+        return col;
+      }
+      while (true) {
+        col->value.push_back(readValue());
+        skipWhitespace();
+        if (peek() == _(',')) {
+          ++pos;
+        } else {
+          expect(_(']'));
+          return col;
+        }
+      }
+    } else if (c == _('"')) {
+      return to_script(readString());
+    } else if (c == _('-') || (c >= _('0') && c <= _('9'))) {
+      return readNumber();
+    } else if (readWord(_("true"))) {
+      return script_true;
+    } else if (readWord(_("false"))) {
+      return script_false;
+    } else if (readWord(_("null"))) {
+      return script_nil;
+    } else {
+      fail(_("expected a value"));
+      return ScriptValueP();
+    }
+  }
+
+  String readString() {
+    ++pos; // "
+    String out;
+    while (true) {
+      if (pos >= text.size()) fail(_("unterminated string"));
+      wxUniChar c = text.GetChar(pos++);
+      if (c == _('"')) {
+        return out;
+      } else if (c != _('\\')) {
+        out += c;
+        continue;
+      }
+      if (pos >= text.size()) fail(_("unterminated string"));
+      c = text.GetChar(pos++);
+      if      (c == _('"') || c == _('\\') || c == _('/')) out += c;
+      else if (c == _('b')) out += _('\b');
+      else if (c == _('f')) out += _('\f');
+      else if (c == _('n')) out += _('\n');
+      else if (c == _('r')) out += _('\r');
+      else if (c == _('t')) out += _('\t');
+      else if (c == _('u')) {
+        unsigned int code = readHex4();
+        if (code >= 0xD800 && code < 0xDC00 && readWord(_("\\u"))) {
+          // surrogate pair
+          unsigned int low = readHex4();
+          if (low < 0xDC00 || low >= 0xE000) fail(_("invalid surrogate pair"));
+          code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+        }
+        out += wxUniChar(code);
+      } else {
+        fail(_("invalid escape sequence"));
+      }
+    }
+  }
+  unsigned int readHex4() {
+    unsigned int code = 0;
+    for (int i = 0 ; i < 4 ; ++i) {
+      unsigned int c = peek().GetValue();
+      ++pos;
+      if      (c >= '0' && c <= '9') code = code * 16 + (c - '0');
+      else if (c >= 'a' && c <= 'f') code = code * 16 + (c - 'a' + 10);
+      else if (c >= 'A' && c <= 'F') code = code * 16 + (c - 'A' + 10);
+      else fail(_("invalid \\u escape"));
+    }
+    return code;
+  }
+
+  ScriptValueP readNumber() {
+    size_t start = pos;
+    bool is_int = true;
+    if (peek() == _('-')) ++pos;
+    while (pos < text.size()) {
+      wxUniChar c = text.GetChar(pos);
+      if (c >= _('0') && c <= _('9')) {
+        // digit
+      } else if (c == _('.') || c == _('e') || c == _('E') || c == _('+') || c == _('-')) {
+        is_int = false;
+      } else {
+        break;
+      }
+      ++pos;
+    }
+    String number = text.substr(start, pos - start);
+    long l;
+    double d;
+    if (is_int && number.ToLong(&l) && l >= INT_MIN && l <= INT_MAX) {
+      return to_script((int)l);
+    } else if (number.ToCDouble(&d)) {
+      return to_script(d);
+    } else {
+      fail(_("invalid number"));
+      return ScriptValueP();
+    }
+  }
+};
+
+ScriptValueP json_to_script(const String& json) {
+  return JsonReader(json).readDocument();
+}
+
+// ----------------------------------------------------------------------------- : Writing
+
+void json_quote(String& out, const String& str) {
+  out += _('"');
+  FOR_EACH_CONST(c, str) {
+    if (c == _('"') || c == _('\\')) {
+      out += _('\\');
+      out += c;
+    } else if (c == _('\n')) {
+      out += _("\\n");
+    } else if (c == _('\r')) {
+      out += _("\\r");
+    } else if (c == _('\t')) {
+      out += _("\\t");
+    } else if (wxUniChar(c).GetValue() < 0x20 || wxUniChar(c).GetValue() >= 0x7F) {
+      unsigned int code = wxUniChar(c).GetValue();
+      if (code >= 0x10000) {
+        // surrogate pair
+        code -= 0x10000;
+        out += String::Format(_("\\u%04x\\u%04x"), 0xD800 + (code >> 10), 0xDC00 + (code & 0x3FF));
+      } else {
+        out += String::Format(_("\\u%04x"), code);
+      }
+    } else {
+      out += c;
+    }
+  }
+  out += _('"');
+}
+
+void write_json(String& out, const ScriptValueP& value) {
+  switch (value->type()) {
+    case SCRIPT_NIL:
+      out += _("null");
+      break;
+    case SCRIPT_INT:
+      out += String::Format(_("%d"), value->toInt());
+      break;
+    case SCRIPT_BOOL:
+      out += value->toBool() ? _("true") : _("false");
+      break;
+    case SCRIPT_DOUBLE: {
+      double d = value->toDouble();
+      if (std::isfinite(d)) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.17g", d);
+        String number(buf, wxConvLibc);
+        number.Replace(_(","), _(".")); // in case the C locale uses a decimal comma
+        out += number;
+      } else {
+        out += _("null");
+      }
+      break;
+    }
+    case SCRIPT_STRING:
+      json_quote(out, value->toString());
+      break;
+    case SCRIPT_COLLECTION: {
+      // it is an object if there are string keys
+      vector<pair<ScriptValueP,ScriptValueP>> items;
+      bool has_keys = false;
+      ScriptValueP it = value->makeIterator();
+      while (true) {
+        ScriptValueP key;
+        ScriptValueP item = it->next(&key);
+        if (!item) break;
+        has_keys |= key && key->type() == SCRIPT_STRING;
+        items.emplace_back(key, item);
+      }
+      out += has_keys ? _('{') : _('[');
+      for (size_t i = 0 ; i < items.size() ; ++i) {
+        if (i > 0) out += _(',');
+        if (has_keys) {
+          json_quote(out, items[i].first ? items[i].first->toString() : String::Format(_("%d"), (int)i));
+          out += _(':');
+        }
+        write_json(out, items[i].second);
+      }
+      out += has_keys ? _('}') : _(']');
+      break;
+    }
+    default:
+      json_quote(out, value->toCode());
+  }
+}
+
+String script_to_json(const ScriptValueP& value) {
+  String out;
+  write_json(out, value);
+  return out;
+}
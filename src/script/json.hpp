@@ -0,0 +1,31 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#pragma once
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+
+DECLARE_POINTER_TYPE(ScriptValue);
+
+// ----------------------------------------------------------------------------- : JSON
+
+/// Convert JSON text to a script value
+/** Objects become collections with keys, arrays become lists, and null becomes nil.
+ *  Throws a ParseError if the text is not valid JSON.
+ */
+ScriptValueP json_to_script(const String& json);
+
+/// Convert a script value to JSON text
+/** Collections become objects if they have string keys, and arrays otherwise.
+ *  Values without a JSON equivalent, like cards and images, are written as a string containing their script code.
+ *  Non-ASCII characters are escaped, so the result is plain ASCII.
+ */
+String script_to_json(const ScriptValueP& value);
+
+/// Append a string to JSON text, quoted and escaped
+void json_quote(String& out, const String& str);
@@ -14,6 +14,7 @@
 #include <util/tagged_string.hpp>
 #include <util/io/package_manager.hpp> // for "include file" semi hack
 #include <stack>
+#include <util/lru_cache.hpp>
 
 #ifdef __WXMSW__
 #define TokenType TokenType_ // some stupid windows header uses our name
@@ -99,6 +100,8 @@ public:
   Packaged* package; ///< Package the input is from
   /// All errors found
   vector<ScriptParseError>& errors;
+  /// Were files included? Then the script depends on the package
+  bool includes_files;
   /// Add an error message
   void add_error(const String& message);
   /// Expected some token instead of what was found, possibly a matching opening bracket is known
@@ -135,6 +138,7 @@ TokenIterator::TokenIterator(const String& str, Packaged* package, bool string_m
   , package(package)
   , newline(false)
   , errors(errors)
+  , includes_files(false)
 {
   if (string_mode) {
     open_braces.push(BRACE_STRING_MODE);
@@ -405,21 +409,29 @@ ExprType parseTopLevel(TokenIterator& input, Script& script) {
   return type;
 }
 
-ScriptP parse(const String& s, Packaged* package, bool string_mode, vector<ScriptParseError>& errors_out) {
+/// Parse a script, sets includes_files if the script includes other files
+ScriptP parse(const String& s, Packaged* package, bool string_mode, vector<ScriptParseError>& errors_out, bool& includes_files) {
   errors_out.clear();
   // parse
   const String filename;
   TokenIterator input(s, package, string_mode, filename, errors_out);
   ScriptP script(new Script);
   ExprType type = parseTopLevel(input, *script);
+  includes_files = input.includes_files;
   // were there fatal errors?
   if (type == EXPR_FAILED) {
     return ScriptP();
   } else {
+    script->optimize();
     return script;
   }
 }
 
+ScriptP parse(const String& s, Packaged* package, bool string_mode, vector<ScriptParseError>& errors_out) {
+  bool includes_files;
+  return parse(s, package, string_mode, errors_out, includes_files);
+}
+
 ScriptP parse(const String& s, Packaged* package, bool string_mode) {
   vector<ScriptParseError> errors;
   ScriptP script = parse(s, package, string_mode, errors);
@@ -429,6 +441,36 @@ ScriptP parse(const String& s, Packaged* package, bool string_mode) {
   return script;
 }
 
+// ----------------------------------------------------------------------------- : Parsing : cache
+
+/// Maximum number of cached scripts in each mode
+const size_t MAX_PARSE_CACHE_SIZE = 100000;
+/// Parsed scripts by their text, for normal and string mode
+/** Packages can be read from multiple threads, the caches do their own locking */
+LruCache<String,ScriptP> parse_cache[2] = {LruCache<String,ScriptP>(MAX_PARSE_CACHE_SIZE), LruCache<String,ScriptP>(MAX_PARSE_CACHE_SIZE)};
+
+ScriptP parse_cached(const String& s, Packaged* package, bool string_mode, vector<ScriptParseError>& errors_out) {
+  LruCache<String,ScriptP>& cache = parse_cache[string_mode];
+  ScriptP script;
+  if (cache.find(s, script)) {
+    errors_out.clear();
+    return script;
+  }
+  // another thread might parse the same script at the same time, that only costs time
+  bool includes_files;
+  script = parse(s, package, string_mode, errors_out, includes_files);
+  // the result of an include depends on the package, so such scripts are not shared
+  if (script && errors_out.empty() && !includes_files) {
+    cache.store(s, script);
+  }
+  return script;
+}
+
+void clear_parse_cache() {
+  parse_cache[0].clear();
+  parse_cache[1].clear();
+}
+
 
 // Expect a token, adds an error if it is not found
 bool expectToken(TokenIterator& input, const Char* expect, const Token* opening = nullptr, const Char* name_in_error = nullptr) {
@@ -682,6 +724,7 @@ ExprType parseExpr(TokenIterator& input, Script& script, Precedence minPrec) {
       expectToken(input, _(")"), &token);
       // include the file
       // read the entire file, and start at the beginning of it
+      input.includes_files = true;
       String const& filename = token.value;
       auto [stream,file_package] = package_manager.openFileFromPackage(input.package, filename);
       eat_utf8_bom(*stream);
@@ -35,3 +35,17 @@ ScriptP parse(const String& s, Packaged* package, bool string_mode, vector<Scrip
  */
 ScriptP parse(const String& s, Packaged* package = nullptr, bool string_mode = false);
 
+/// Parse a String to a Script, sharing the Script with earlier parses of the same String
+/** Games, stylesheets and sets repeat many identical scripts, this parses each only once.
+ *  Parsing only depends on the text and the string_mode, except for scripts with include files,
+ *  which are parsed every time.
+ *  Scripts with errors are not cached, the errors are stored in errors_out, like parse.
+ *
+ *  The returned Script is shared, it must not be modified.
+ */
+ScriptP parse_cached(const String& s, Packaged* package, bool string_mode, vector<ScriptParseError>& errors_out);
+
+/// Forget the scripts cached by parse_cached
+/** Must be called before the program terminates, like PackageManager::destroy */
+void clear_parse_cache();
+
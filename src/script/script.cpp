@@ -126,11 +126,13 @@ void Script::addInstruction(InstructionType t, Addr d) {
 }
 void Script::addInstruction(InstructionType t, const ScriptValueP& c) {
   constants.push_back(c);
+  member_caches.resize(constants.size());
   Instruction i = {t, {(unsigned int)constants.size() - 1}};
   instructions.push_back(i);
 }
 void Script::addInstruction(InstructionType t, const String& s) {
   constants.push_back(to_script(s));
+  member_caches.resize(constants.size());
   Instruction i = {t, {(unsigned int)constants.size() - 1}};
   instructions.push_back(i);
 }
@@ -244,6 +246,258 @@ String Script::dumpInstr(unsigned int pos, Instruction i) const {
 #endif
 
 
+// ----------------------------------------------------------------------------- : Optimization
+
+// Perform simple instructions, defined in context.cpp
+void instrUnary  (UnaryInstructionType   i, ScriptValueP& a);
+void instrBinary (BinaryInstructionType  i, ScriptValueP& a, const ScriptValueP& b);
+void instrTernary(TernaryInstructionType i, ScriptValueP& a, const ScriptValueP& b, const ScriptValueP& c);
+void instrQuaternary(QuaternaryInstructionType i, ScriptValueP& a, const ScriptValueP& b, const ScriptValueP& c, const ScriptValueP& d);
+
+bool is_jump(InstructionType t) {
+  return t == I_JUMP || t == I_JUMP_IF_NOT || t == I_JUMP_SC_AND || t == I_JUMP_SC_OR
+      || t == I_LOOP || t == I_LOOP_WITH_KEY;
+}
+bool is_call(InstructionType t) {
+  return t == I_CALL || t == I_TAILCALL || t == I_CLOSURE;
+}
+
+/// Can operations on this constant be done at compile time?
+/** Only plain values, functions and other objects could have side effects or depend on the context */
+bool is_foldable(const ScriptValueP& v) {
+  ScriptType t = v->type();
+  return t == SCRIPT_NIL || t == SCRIPT_INT || t == SCRIPT_BOOL || t == SCRIPT_DOUBLE
+      || t == SCRIPT_STRING || t == SCRIPT_COLOR;
+}
+
+bool is_foldable(BinaryInstructionType i) {
+  return i != I_ITERATOR_R && i != I_MEMBER && i != I_OR_ELSE;
+}
+
+/// Try to evaluate a simple instruction on constant arguments.
+/** Returns nullptr if this can not be done at compile time, for example because the instruction gives an error;
+ *  the error should then happen when the script is run.
+ */
+ScriptValueP fold(Instruction i, const ScriptValueP* args, int n) {
+  for (int j = 0 ; j < n ; ++j) {
+    if (!is_foldable(args[j])) return nullptr;
+  }
+  try {
+    ScriptValueP a = args[0];
+    switch (i.instr) {
+      case I_UNARY:
+        if (i.instr1 == I_ITERATOR_C) return nullptr;
+        instrUnary(i.instr1, a);
+        break;
+      case I_BINARY:
+        if (!is_foldable(i.instr2)) return nullptr;
+        if ((i.instr2 == I_DIV || i.instr2 == I_MOD) && args[1]->type() != SCRIPT_DOUBLE && args[1]->toInt() == 0) {
+          return nullptr; // integer division by zero
+        }
+        instrBinary(i.instr2, a, args[1]);
+        break;
+      case I_TERNARY:
+        instrTernary(i.instr3, a, args[1], args[2]);
+        break;
+      case I_QUATERNARY:
+        instrQuaternary(i.instr4, a, args[1], args[2], args[3]);
+        break;
+      default:
+        return nullptr;
+    }
+    return is_foldable(a) ? a : nullptr;
+  } catch (const Error&) {
+    return nullptr;
+  }
+}
+
+/// Which positions are the target of a jump?
+void find_jump_targets(const vector<Instruction>& instrs, vector<bool>& targets) {
+  targets.assign(instrs.size() + 1, false);
+  for (size_t i = 0 ; i < instrs.size() ; ++i) {
+    if (is_jump(instrs[i].instr)) targets[instrs[i].data] = true;
+    if (is_call(instrs[i].instr)) i += instrs[i].data; // skip arguments
+  }
+}
+
+/// Remove the marked instructions, and update jump addresses
+/** Jumps to a removed instruction will go to the next instruction that is not removed */
+void remove_instructions(vector<Instruction>& instrs, const vector<bool>& remove) {
+  vector<unsigned int> new_pos(instrs.size() + 1);
+  unsigned int pos = 0;
+  for (size_t i = 0 ; i < instrs.size() ; ++i) {
+    new_pos[i] = pos;
+    if (!remove[i]) instrs[pos++] = instrs[i];
+  }
+  new_pos[instrs.size()] = pos;
+  instrs.resize(pos);
+  for (size_t i = 0 ; i < instrs.size() ; ++i) {
+    if (is_jump(instrs[i].instr)) instrs[i].data = new_pos[instrs[i].data];
+    if (is_call(instrs[i].instr)) i += instrs[i].data;
+  }
+}
+
+/// Mark the instructions that can not be reached from the start, returns true if there are any
+bool find_unreachable(const vector<Instruction>& instrs, vector<bool>& unreachable) {
+  unreachable.assign(instrs.size(), true);
+  vector<unsigned int> todo(1, 0);
+  while (!todo.empty()) {
+    unsigned int i = todo.back(); todo.pop_back();
+    while (i < instrs.size() && unreachable[i]) {
+      unreachable[i] = false;
+      Instruction instr = instrs[i];
+      if (is_jump(instr.instr)) {
+        todo.push_back(instr.data);
+        if (instr.instr == I_JUMP) break; // no fall through
+      } else if (is_call(instr.instr)) {
+        for (unsigned int j = 1 ; j <= instr.data ; ++j) unreachable[i + j] = false; // arguments
+        i += instr.data;
+      }
+      ++i;
+    }
+  }
+  FOR_EACH_CONST(u, unreachable) {
+    if (u) return true;
+  }
+  return false;
+}
+
+/// One round of optimization, returns true if something changed
+bool optimize_step(vector<Instruction>& instrs, vector<ScriptValueP>& constants) {
+  vector<bool> targets, remove;
+  find_jump_targets(instrs, targets);
+  bool changed = find_unreachable(instrs, remove);
+  // Note: in the patterns below, only the first instruction may be a jump target,
+  //       and instructions are only removed if they have not been touched in this round.
+  for (size_t i = 0 ; i < instrs.size() ; ++i) {
+    Instruction& instr = instrs[i];
+    if (remove[i]) continue;
+    if (is_call(instr.instr)) {
+      i += instr.data; // skip arguments
+      continue;
+    }
+    // Constant folding:
+    //   PUSH_CONST a; PUSH_CONST b; BINARY op   -->  PUSH_CONST (a op b)
+    int arity = instr.instr == I_UNARY ? 1 : instr.instr == I_BINARY ? 2 : instr.instr == I_TERNARY ? 3 : instr.instr == I_QUATERNARY ? 4 : 0;
+    if (arity && i >= (size_t)arity) {
+      size_t first = i - arity;
+      bool ok = true;
+      ScriptValueP args[4];
+      for (int j = 0 ; j < arity && ok ; ++j) {
+        const Instruction& arg = instrs[first + j];
+        ok = arg.instr == I_PUSH_CONST && !remove[first + j] && (j == 0 || !targets[first + j]);
+        if (ok) args[j] = constants[arg.data];
+      }
+      if (ok && !targets[i]) {
+        ScriptValueP result = fold(instr, args, arity);
+        if (result) {
+          constants.push_back(result);
+          instrs[first].data = (unsigned int)constants.size() - 1;
+          for (size_t j = first + 1 ; j <= i ; ++j) remove[j] = true;
+          changed = true;
+          continue;
+        }
+      }
+    }
+    // Conditions on constants
+    //   PUSH_CONST true;  JUMP_IF_NOT x  -->  (nothing)
+    //   PUSH_CONST false; JUMP_IF_NOT x  -->  JUMP x
+    // and similarly for the short circuiting and/or, where the value is kept when jumping
+    if ((instr.instr == I_JUMP_IF_NOT || instr.instr == I_JUMP_SC_AND || instr.instr == I_JUMP_SC_OR)
+        && i > 0 && !targets[i] && !remove[i-1] && instrs[i-1].instr == I_PUSH_CONST
+        && is_foldable(constants[instrs[i-1].data])) {
+      bool condition;
+      try {
+        condition = constants[instrs[i-1].data]->toBool();
+      } catch (const Error&) {
+        continue; // leave the error for run time
+      }
+      bool jump = instr.instr == I_JUMP_SC_OR ? condition : !condition;
+      if (!jump) {
+        remove[i-1] = remove[i] = true;
+      } else if (instr.instr == I_JUMP_IF_NOT) {
+        instrs[i-1] = instr; // the condition is popped
+        instrs[i-1].instr = I_JUMP;
+        remove[i] = true;
+      } else {
+        instr.instr = I_JUMP; // the condition stays on the stack
+      }
+      changed = true;
+      continue;
+    }
+    // Jump threading
+    //   JUMP a; ... a: JUMP b  -->  JUMP b; ... a: JUMP b
+    // a short circuiting jump to a jump of the same kind will also take that jump.
+    // Only forward jumps are threaded, dependency analysis relies on conditional jumps going forward.
+    if (instr.instr == I_JUMP || instr.instr == I_JUMP_IF_NOT || instr.instr == I_JUMP_SC_AND || instr.instr == I_JUMP_SC_OR) {
+      unsigned int target = instr.data;
+      while (target < instrs.size() && target > i && !remove[target] &&
+             (instrs[target].instr == I_JUMP ||
+              (instrs[target].instr == instr.instr && instr.instr != I_JUMP_IF_NOT)) &&
+             instrs[target].data > target) {
+        target = instrs[target].data;
+      }
+      if (target != instr.data) {
+        instr.data = target;
+        changed = true;
+      }
+    }
+    // Jump to the next instruction
+    if (instr.instr == I_JUMP && instr.data == i + 1) {
+      remove[i] = true;
+      changed = true;
+      continue;
+    }
+    // Values that are discarded
+    //   PUSH_CONST x; POP  -->  (nothing)
+    //   DUP n;        POP  -->  (nothing)
+    if (instr.instr == I_POP && i > 0 && !targets[i] && !remove[i-1] &&
+        (instrs[i-1].instr == I_PUSH_CONST || instrs[i-1].instr == I_DUP)) {
+      remove[i-1] = remove[i] = true;
+      changed = true;
+      continue;
+    }
+  }
+  if (changed) remove_instructions(instrs, remove);
+  return changed;
+}
+
+/// Remove constants that are no longer used
+void remove_unused_constants(vector<Instruction>& instrs, vector<ScriptValueP>& constants) {
+  vector<unsigned int> new_index(constants.size(), (unsigned int)-1);
+  vector<ScriptValueP> used;
+  for (size_t i = 0 ; i < instrs.size() ; ++i) {
+    Instruction& instr = instrs[i];
+    if (instr.instr == I_PUSH_CONST || instr.instr == I_MEMBER_C) {
+      if (new_index[instr.data] == (unsigned int)-1) {
+        new_index[instr.data] = (unsigned int)used.size();
+        used.push_back(constants[instr.data]);
+      }
+      instr.data = new_index[instr.data];
+    }
+    if (is_call(instr.instr)) i += instr.data;
+  }
+  constants.swap(used);
+}
+
+void Script::optimize() {
+  // don't touch scripts with unfinished jumps
+  for (size_t i = 0 ; i < instructions.size() ; ++i) {
+    if (is_jump(instructions[i].instr) && instructions[i].data > instructions.size()) return;
+    if (is_call(instructions[i].instr)) i += instructions[i].data;
+  }
+  while (optimize_step(instructions, constants)) {}
+  remove_unused_constants(instructions, constants);
+  member_caches.clear();
+  member_caches.resize(constants.size());
+  // optimize functions defined in this script
+  FOR_EACH(c, constants) {
+    if (Script* s = dynamic_cast<Script*>(c.get())) {
+      s->optimize();
+    }
+  }
+}
+
 // ----------------------------------------------------------------------------- : Backtracing
 
 const Instruction* Script::backtraceSkip(const Instruction* instr, int to_skip) const {
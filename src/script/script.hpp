@@ -198,6 +198,12 @@ public:
   /// Get access to the vector of constants
   inline vector<ScriptValueP>& getConstants()   { return constants; }
   
+  /// Optimize the instructions of this script, and of the functions it contains
+  /** Folds operations on constants, threads jumps and removes unreachable code.
+   *  Should be called once, after the script is complete.
+   */
+  void optimize();
+  
   /// Output the instructions in a human readable format
   String dumpScript() const;
   /// Output an instruction in a human readable format
@@ -210,6 +216,8 @@ private:
   vector<Instruction>  instructions;
   /// Constant values that can be referred to from the script
   vector<ScriptValueP> constants;
+  /// Inline caches for member lookups by I_MEMBER_C instructions, one for each constant
+  mutable vector<MemberCache> member_caches;
   
   /// Do a backtrace for error messages.
   /** Starting from instr, move backwards until the nett stack effect
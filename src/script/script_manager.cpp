@@ -20,6 +20,8 @@
 #include <data/action/value.hpp>
 #include <data/action/keyword.hpp>
 #include <util/error.hpp>
+#include <util/trace.hpp>
+#include <wx/thread.h>
 
 // ----------------------------------------------------------------------------- : SetScriptContext : initialization
 
@@ -79,6 +81,7 @@ Context& SetScriptContext::getContext(const CardP& card) {
 SetScriptManager::SetScriptManager(Set& set)
   : SetScriptContext(set)
   , delay(0)
+  , own_change(nullptr)
 {
   // add as an action listener for the set, so we receive actions
   set.actions.addListener(this);
@@ -111,6 +114,55 @@ void SetScriptManager::initDependencies(Context& ctx, Game& game) {
   FOR_EACH(f, game.set_fields) {
     f->initDependencies(ctx, Dependency(DEP_SET_FIELD, f->index));
   }
+  initUpdateOrder(game);
+}
+
+/// Add edges from a field to the fields whose scripts depend on it
+void add_update_order_edges(const Game& game, Field* from, const Dependencies& deps, size_t copy_depth, vector<pair<Field*,Field*>>& edges) {
+  FOR_EACH_CONST(d, deps) {
+    switch (d.type) {
+      case DEP_SET_FIELD:
+        edges.emplace_back(from, game.set_fields.at(d.index).get());
+        break;
+      case DEP_CARD_FIELD: case DEP_CARDS_FIELD:
+        edges.emplace_back(from, game.card_fields.at(d.index).get());
+        break;
+      case DEP_CARD_COPY_DEP: case DEP_SET_COPY_DEP: {
+        // the scripts depending on the other field also depend on this one
+        if (copy_depth > game.card_fields.size() + game.set_fields.size()) break; // cyclic copies
+        const FieldP& f = d.type == DEP_CARD_COPY_DEP ? game.card_fields.at(d.index) : game.set_fields.at(d.index);
+        add_update_order_edges(game, from, f->dependent_scripts, copy_depth + 1, edges);
+        break;
+      }
+      default:
+        break; // styles are not updated through the queue
+    }
+  }
+}
+
+void SetScriptManager::initUpdateOrder(Game& game) {
+  vector<pair<Field*,Field*>> edges;
+  FOR_EACH(f, game.card_fields) {
+    f->update_order = 0;
+    add_update_order_edges(game, f.get(), f->dependent_scripts, 0, edges);
+  }
+  FOR_EACH(f, game.set_fields) {
+    f->update_order = 0;
+    add_update_order_edges(game, f.get(), f->dependent_scripts, 0, edges);
+  }
+  // the order of a field is the length of the longest dependency chain leading to it,
+  // with cyclic dependencies we give up after as many rounds as there are fields
+  size_t field_count = game.card_fields.size() + game.set_fields.size();
+  for (size_t round = 0 ; round < field_count ; ++round) {
+    bool changed = false;
+    FOR_EACH(e, edges) {
+      if (e.second->update_order <= e.first->update_order) {
+        e.second->update_order = e.first->update_order + 1;
+        changed = true;
+      }
+    }
+    if (!changed) break;
+  }
 }
 
 
@@ -163,21 +215,41 @@ void SetScriptManager::onAction(const Action& action, bool undone) {
       updateValue(*action.valueP, CardP());
     }
   }
-  TYPE_CASE_(action, ScriptValueEvent) {
-    return; // Don't go into an infinite loop because of our own events
+  TYPE_CASE(action, ScriptValueEvent) {
+    // Don't go into an infinite loop because of our own events, updateToUpdate takes care of their dependencies
+    if (action.value == own_change) return;
+    // a script function (combined_editor) changed another value, also update the things depending on that value
+    CardP card = action.card ? const_cast<Card*>(action.card)->intrusive_from_this() : CardP();
+    updateAllDependend(action.value->fieldP->dependent_scripts, card);
+    return;
   }
   TYPE_CASE(action, AddCardAction) {
+    // cards were added or removed
+    // in a batch, so values that depend on many of the cards are only updated once
+    ActionBatch batch(set.actions);
+    if (!action.action.adding && undone) {
+      // removed cards are put back in their old place, cards with equal order keys should be ordered by that place
+      set.clearOrderCache();
+    } else {
+      FOR_EACH_CONST(step, action.action.steps) {
+        set.invalidateOrderCache(step.item);
+      }
+    }
     if (action.action.adding != undone) {
       // update the added cards specificly
       FOR_EACH_CONST(step, action.action.steps) {
         const CardP& card = step.item;
-        Context& ctx = getContext(card);
         FOR_EACH(v, card->data) {
-          v->update(ctx);
+          updateValue(*v, card);
         }
       }
     }
-    // note: fallthrough
+    updateAllDependend(set.game->dependent_scripts_cards);
+    return;
+  }
+  TYPE_CASE_(action, ReorderCardsAction) {
+    // cards with equal order keys are ordered by their place in the list
+    set.clearOrderCache();
   }
   TYPE_CASE_(action, CardListAction) {
     #ifdef LOG_UPDATES
@@ -197,9 +269,11 @@ void SetScriptManager::onAction(const Action& action, bool undone) {
     return;
   }
   TYPE_CASE(action, ChangeCardStyleAction) {
+    set.invalidateOrderCache(action.card); // scripts are evaluated in another context
     updateAllDependend(set.game->dependent_scripts_stylesheet, action.card);
   }
   TYPE_CASE_(action, ChangeSetStyleAction) {
+    set.clearOrderCache();
     updateAllDependend(set.game->dependent_scripts_stylesheet);
     return;
   }
@@ -207,6 +281,7 @@ void SetScriptManager::onAction(const Action& action, bool undone) {
 
 void SetScriptManager::updateStyles(const CardP& card, bool only_content_dependent) {
   assert(card);
+  TRACE_SCOPE("script", "update styles");
   const StyleSheet& stylesheet = set.stylesheetFor(card);
   Context& ctx = getContext(card);
   if (!only_content_dependent) {
@@ -216,7 +291,7 @@ void SetScriptManager::updateStyles(const CardP& card, bool only_content_depende
       if (v->update(ctx)) {
         // changed, send event
         ScriptValueEvent change(card.get(), v.get());
-        set.actions.tellListeners(change, false);
+        tellOwnChange(change);
       }
     }
   }
@@ -247,14 +322,19 @@ void SetScriptManager::updateDelayed() {
 }
 
 void SetScriptManager::updateValue(Value& value, const CardP& card) {
+  TRACE_SCOPE("script", "update value", value.fieldP->name);
   Age starting_age; // the start of the update process
-  deque<ToUpdate> to_update;
+  UpdateQueue to_update;
   // execute script for initial changed value
   value.update(getContext(card));
   #ifdef LOG_UPDATES
     wxLogDebug(_("Start:     %s"), value.fieldP->name);
   #endif
-  // update dependent scripts
+  // update dependent scripts, in a batch that is done at the end
+  if (set.actions.inBatch()) {
+    alsoUpdate(pending, value.fieldP->dependent_scripts, card);
+    return;
+  }
   alsoUpdate(to_update, value.fieldP->dependent_scripts, card);
   updateRecursive(to_update, starting_age);
   #ifdef LOG_UPDATES
@@ -267,6 +347,8 @@ void SetScriptManager::updateAll() {
     wxLogDebug(_("Update all"));
   #endif
   wxBusyCursor busy;
+  TRACE_SCOPE("script", "update all");
+  set.clearOrderCache(); // all values are evaluated again without looking at dependencies
   // update set data
   Context& ctx = getContext(set.stylesheet);
   FOR_EACH(v, set.data) {
@@ -278,20 +360,9 @@ void SetScriptManager::updateAll() {
     }
   }
   // update card data of all cards
-  FOR_EACH(card, set.cards) {
-    Context& ctx = getContext(card);
-    FOR_EACH(v, card->data) {
-      try {
-        #if USE_SCRIPT_PROFILING
-          Timer t;
-          Profiler prof(t, v->fieldP.get(), _("update card.") + v->fieldP->name);
-        #endif
-        v->update(ctx);
-      } catch (const ScriptError& e) {
-        handle_error(ScriptError(e.what() + _("\n  while updating card value '") + v->fieldP->name + _("'")));
-      }
-    }
-  }
+  updateAllCards();
+  // the cards were updated without invalidating the order caches, so they may have been filled with old values
+  set.clearOrderCache();
   // update things that depend on the card list
   updateAllDependend(set.game->dependent_scripts_cards);
   #ifdef LOG_UPDATES
@@ -300,24 +371,38 @@ void SetScriptManager::updateAll() {
 }
 
 void SetScriptManager::updateAllDependend(const vector<Dependency>& dependent_scripts, const CardP& card) {
-  deque<ToUpdate> to_update;
+  if (set.actions.inBatch()) {
+    alsoUpdate(pending, dependent_scripts, card);
+    return;
+  }
+  UpdateQueue to_update;
   Age starting_age;
   alsoUpdate(to_update, dependent_scripts, card);
   updateRecursive(to_update, starting_age);
 }
 
-void SetScriptManager::updateRecursive(deque<ToUpdate>& to_update, Age starting_age) {
+void SetScriptManager::onEndBatch() {
+  if (pending.empty()) return;
+  TRACE_SCOPE("script", "update batch");
+  UpdateQueue to_update;
+  swap(to_update, pending);
+  // cards removed during the batch don't need to be updated
+  to_update.keepCards(set.cards);
+  Age starting_age;
+  updateRecursive(to_update, starting_age);
+}
+
+void SetScriptManager::updateRecursive(UpdateQueue& to_update, Age starting_age) {
   if (to_update.empty()) return;
-  set.clearOrderCache(); // clear caches before evaluating a round of scripts
   while (!to_update.empty()) {
-    updateToUpdate(to_update.front(), to_update, starting_age);
-    to_update.pop_front();
+    updateToUpdate(to_update.pop(), to_update, starting_age);
   }
 }
 
-void SetScriptManager::updateToUpdate(const ToUpdate& u, deque<ToUpdate>& to_update, Age starting_age) {
+void SetScriptManager::updateToUpdate(const ToUpdate& u, UpdateQueue& to_update, Age starting_age) {
   Age age = u.value->last_script_update;
   if (starting_age <= age)  return; // this value was already updated
+  TRACE_SCOPE("script", "update dependent value", u.value->fieldP->name);
   Context& ctx = getContext(u.card);
   bool changes = false;
   try {
@@ -328,7 +413,7 @@ void SetScriptManager::updateToUpdate(const ToUpdate& u, deque<ToUpdate>& to_upd
   if (changes) {
     // changed, send event
     ScriptValueEvent change(u.card.get(), u.value);
-    set.actions.tellListeners(change, false);
+    tellOwnChange(change);
     // u.value has changed, also update values with a dependency on u.value
     alsoUpdate(to_update, u.value->fieldP->dependent_scripts, u.card);
   #ifdef LOG_UPDATES
@@ -341,17 +426,29 @@ void SetScriptManager::updateToUpdate(const ToUpdate& u, deque<ToUpdate>& to_upd
   #endif
 }
 
-void SetScriptManager::alsoUpdate(deque<ToUpdate>& to_update, const vector<Dependency>& deps, const CardP& card) {
+void SetScriptManager::tellOwnChange(const ScriptValueEvent& change) {
+  const Value* outer = own_change;
+  own_change = change.value;
+  try {
+    set.actions.tellListeners(change, false);
+  } catch (...) {
+    own_change = outer;
+    throw;
+  }
+  own_change = outer;
+}
+
+void SetScriptManager::alsoUpdate(UpdateQueue& to_update, const vector<Dependency>& deps, const CardP& card) {
   FOR_EACH_CONST(d, deps) {
     switch (d.type) {
       case DEP_SET_FIELD: {
         ValueP value = set.data.at(d.index);
-        to_update.push_back(ToUpdate(value.get(), CardP()));
+        to_update.push(value.get(), CardP());
         break;
       } case DEP_CARD_FIELD: {
         if (card) {
           ValueP value = card->data.at(d.index);
-          to_update.push_back(ToUpdate(value.get(), card));
+          to_update.push(value.get(), card);
           break;
         } else {
           // There is no card, so the update should affect all cards (fall through).
@@ -360,7 +457,7 @@ void SetScriptManager::alsoUpdate(deque<ToUpdate>& to_update, const vector<Depen
         // something invalidates a card value for all cards, so all cards need updating
         FOR_EACH(card, set.cards) {
           ValueP value = card->data.at(d.index);
-          to_update.push_back(ToUpdate(value.get(), card));
+          to_update.push(value.get(), card);
         }
         break;
       } case DEP_CARD_STYLE: {
@@ -380,7 +477,7 @@ void SetScriptManager::alsoUpdate(deque<ToUpdate>& to_update, const vector<Depen
           StyleSheet* stylesheet_card = &set.stylesheetFor(card);
           if (stylesheet == stylesheet_card) {
             ValueP value = card->extra_data.at(d.index);
-            to_update.push_back(ToUpdate(value.get(), card));
+            to_update.push(value.get(), card);
           }
         }*/
         break;
@@ -394,8 +491,191 @@ void SetScriptManager::alsoUpdate(deque<ToUpdate>& to_update, const vector<Depen
         FieldP f = set.game->set_fields[d.index];
         alsoUpdate(to_update, f->dependent_scripts, card);
         break;
+      } case DEP_ORDER_CACHE: {
+        // the position of this card may have changed, or for set fields of all cards
+        set.invalidateOrderCache(card);
+        break;
       } default:
         assert(false);
     }
   }
 }
+
+// ----------------------------------------------------------------------------- : SetScriptManager : update queue
+
+SetScriptManager::ToUpdate::ToUpdate(Value* value, CardP card, size_t seq)
+  : value(value), card(card), order(value->fieldP->update_order), seq(seq)
+{}
+
+void SetScriptManager::UpdateQueue::push(Value* value, const CardP& card) {
+  if (!queued.insert(value).second) return; // already in the queue, or updated in this round
+  queue.push(ToUpdate(value, card, next_seq++));
+}
+
+SetScriptManager::ToUpdate SetScriptManager::UpdateQueue::pop() {
+  ToUpdate u = queue.top();
+  queue.pop();
+  return u;
+}
+
+void SetScriptManager::UpdateQueue::keepCards(const vector<CardP>& cards) {
+  unordered_set<const Card*> keep;
+  FOR_EACH_CONST(c, cards) keep.insert(c.get());
+  vector<ToUpdate> items;
+  while (!queue.empty()) {
+    if (!queue.top().card || keep.count(queue.top().card.get())) items.push_back(queue.top());
+    queue.pop();
+  }
+  FOR_EACH(u, items) queue.push(u);
+}
+
+// ----------------------------------------------------------------------------- : SetScriptManager : updating all cards
+
+/// The work of updating all cards on multiple threads
+/** Each card is updated by a single thread, in the same way as the serial update.
+ *  Errors are collected per card, and reported in card order once all threads are done,
+ *  so the result doesn't depend on the scheduling of the threads.
+ */
+struct CardUpdateJob {
+  /// Data prepared on the main thread for the cards using a stylesheet
+  struct ForStyleSheet {
+    const Context* ctx;     ///< Context with the init scripts applied, copied by each thread
+    ScriptValueP   styling; ///< Styling data for cards without their own styling
+  };
+  
+  CardUpdateJob(const vector<CardP>& cards)
+    : cards(cards), next_card(0), errors(cards.size()), fatal_errors(cards.size())
+  {}
+  
+  const vector<CardP>&      cards;
+  vector<ForStyleSheet*>    stylesheet_for_card; ///< For each card
+  map<const StyleSheet*, ForStyleSheet> stylesheets; ///< Prepared data for each stylesheet in use
+  atomic<size_t>            next_card;           ///< Next card to be claimed by a thread
+  vector<vector<String>>    errors;              ///< Script errors while updating each card
+  vector<String>            fatal_errors;        ///< Other errors that stopped the update of a card
+};
+
+/// A thread that updates cards from a CardUpdateJob until there are none left
+class CardUpdateThread : public wxThread {
+public:
+  CardUpdateThread(CardUpdateJob& job)
+    : wxThread(wxTHREAD_JOINABLE), job(job)
+  {}
+  
+  ExitCode Entry() override {
+    // contexts are not thread safe, so use our own copies
+    map<const CardUpdateJob::ForStyleSheet*, Context> contexts;
+    while (true) {
+      size_t i = job.next_card++;
+      if (i >= job.cards.size()) break;
+      const CardP& card = job.cards[i];
+      const CardUpdateJob::ForStyleSheet* for_stylesheet = job.stylesheet_for_card[i];
+      auto it = contexts.find(for_stylesheet);
+      if (it == contexts.end()) {
+        it = contexts.emplace(for_stylesheet, *for_stylesheet->ctx).first;
+      }
+      Context& ctx = it->second;
+      try {
+        ctx.setVariable(SCRIPT_VAR_card,    to_script(card));
+        ctx.setVariable(SCRIPT_VAR_styling, card->has_styling ? to_script(&card->styling_data) : for_stylesheet->styling);
+        FOR_EACH(v, card->data) {
+          try {
+            v->update(ctx);
+          } catch (const ScriptError& e) {
+            job.errors[i].push_back(e.what() + _("\n  while updating card value '") + v->fieldP->name + _("'"));
+          }
+        }
+      } catch (const Error& e) {
+        job.fatal_errors[i] = e.what();
+      } catch (...) {
+        job.fatal_errors[i] = _("An unexpected exception occurred while updating cards");
+      }
+    }
+    return 0;
+  }
+  
+private:
+  CardUpdateJob& job;
+};
+
+bool SetScriptManager::cardsAreIndependent() const {
+  const Game& game = *set.game;
+  // card scripts that look at the card list (position_of, length of the set), they use the order caches in the set
+  FOR_EACH_CONST(d, game.dependent_scripts_cards) {
+    if (d.type == DEP_CARD_FIELD || d.type == DEP_CARDS_FIELD) return false;
+  }
+  // card scripts that look at values of other cards
+  FOR_EACH_CONST(f, game.card_fields) {
+    FOR_EACH_CONST(d, f->dependent_scripts) {
+      if (d.type == DEP_CARDS_FIELD) return false;
+    }
+  }
+  FOR_EACH_CONST(f, game.set_fields) {
+    FOR_EACH_CONST(d, f->dependent_scripts) {
+      if (d.type == DEP_CARDS_FIELD) return false;
+    }
+  }
+  return true;
+}
+
+void SetScriptManager::updateAllCards() {
+  #if USE_SCRIPT_PROFILING
+    int thread_count = 1; // the profiler is not thread safe
+  #else
+    int thread_count = wxThread::GetCPUCount();
+  #endif
+  if (thread_count > 1 && set.cards.size() >= 2 * (size_t)thread_count) {
+    // prepare the contexts on this thread, this runs init scripts and initializes dependencies
+    CardUpdateJob job(set.cards);
+    FOR_EACH(card, set.cards) {
+      StyleSheetP stylesheet = set.stylesheetForP(card);
+      auto it = job.stylesheets.try_emplace(stylesheet.get());
+      if (it.second) {
+        it.first->second.ctx     = &getContext(stylesheet);
+        it.first->second.styling = to_script(&set.stylingDataFor(*stylesheet));
+      }
+      job.stylesheet_for_card.push_back(&it.first->second);
+    }
+    if (cardsAreIndependent()) {
+      // build the keyword database now, instead of lazily on multiple threads
+      set.keywordDatabase();
+      // update the cards
+      vector<unique_ptr<CardUpdateThread>> threads;
+      for (int i = 0 ; i < thread_count ; ++i) {
+        threads.emplace_back(new CardUpdateThread(job));
+        if (threads.back()->Run() != wxTHREAD_NO_ERROR) {
+          threads.pop_back();
+          break;
+        }
+      }
+      if (!threads.empty()) {
+        FOR_EACH(t, threads) t->Wait();
+        // report errors in card order
+        for (size_t i = 0 ; i < set.cards.size() ; ++i) {
+          FOR_EACH(e, job.errors[i]) {
+            handle_error(ScriptError(e));
+          }
+          if (!job.fatal_errors[i].empty()) {
+            throw Error(job.fatal_errors[i]);
+          }
+        }
+        return;
+      }
+    }
+  }
+  // update cards one at a time on this thread
+  FOR_EACH(card, set.cards) {
+    Context& ctx = getContext(card);
+    FOR_EACH(v, card->data) {
+      try {
+        #if USE_SCRIPT_PROFILING
+          Timer t;
+          Profiler prof(t, v->fieldP.get(), _("update card.") + v->fieldP->name);
+        #endif
+        v->update(ctx);
+      } catch (const ScriptError& e) {
+        handle_error(ScriptError(e.what() + _("\n  while updating card value '") + v->fieldP->name + _("'")));
+      }
+    }
+  }
+}
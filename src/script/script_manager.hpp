@@ -14,9 +14,11 @@
 #include <script/context.hpp>
 #include <script/dependency.hpp>
 #include <queue>
+#include <unordered_set>
 
 class Set;
 class Value;
+class ScriptValueEvent;
 DECLARE_POINTER_TYPE(Game);
 DECLARE_POINTER_TYPE(StyleSheet);
 DECLARE_POINTER_TYPE(Card);
@@ -75,6 +77,15 @@ private:
   
   void initDependencies(Context&, Game&);
   void initDependencies(Context&, StyleSheet&);
+  /// Determine the Field::update_order of the fields of a game from their dependencies
+  void initUpdateOrder(Game&);
+  
+  /// Update all fields of all cards
+  /** When the cards are independent, the cards are divided over multiple worker threads. */
+  void updateAllCards();
+  /// Can the values of a card be updated without looking at other cards?
+  /** Determined from the dependencies of the game's scripts. */
+  bool cardsAreIndependent() const;
   
   /// Update a map of styles
   void updateStyles(Context& ctx, const IndexMap<FieldP,StyleP>& styles, bool only_content_dependent);
@@ -82,21 +93,56 @@ private:
   /** if the value changes any dependend values are updated as well */
   void updateValue(Value& value, const CardP& card);
   // Update all values with a specific dependency
+  /** In a batch of actions the update is postponed until the end of the batch. */
   void updateAllDependend(const vector<Dependency>& dependent_scripts, const CardP& card = CardP());
   
   // Something that needs to be updated
   struct ToUpdate {
-    ToUpdate(Value* value, CardP card) : value(value), card(card) {}
+    ToUpdate(Value* value, CardP card, size_t seq);
     Value* value;  ///< value to update
     CardP  card;   ///< card the value is in, or CadP() if it is not a card field
+    int    order;  ///< update_order of the value's field
+    size_t seq;    ///< when was this added to the queue?
   };
+  /// The things that need to be updated in a round of updates
+  /** Each value is added at most once, a value is only updated once per round anyway.
+   *  Values are taken out in the order of their fields' update_order, and otherwise in the order they were added.
+   *  So values are updated after the values they depend on, unless the dependencies are cyclic.
+   */
+  class UpdateQueue {
+  public:
+    UpdateQueue() : next_seq(0) {}
+    /// Add a value to the queue, unless it was added before
+    void push(Value* value, const CardP& card);
+    /// Take the next value to update from the queue
+    ToUpdate pop();
+    inline bool empty() const { return queue.empty(); }
+    /// Remove values of cards that are not in the given list
+    void keepCards(const vector<CardP>& cards);
+  private:
+    struct Later {
+      inline bool operator () (const ToUpdate& a, const ToUpdate& b) const {
+        return a.order > b.order || (a.order == b.order && a.seq > b.seq);
+      }
+    };
+    priority_queue<ToUpdate, vector<ToUpdate>, Later> queue;
+    unordered_set<const Value*> queued; ///< Values that were ever added
+    size_t next_seq;
+  };
+  /// Updates postponed until the end of a batch of actions
+  UpdateQueue pending;
+  
   /// Update all things in to_update, and things that depent on them, etc.
   /** Only update things that are older than starting_age. */
-  void updateRecursive(deque<ToUpdate>& to_update, Age starting_age);
+  void updateRecursive(UpdateQueue& to_update, Age starting_age);
   /// Update a value given by a ToUpdate object, and add things depending on it to to_update
-  void updateToUpdate(const ToUpdate& u, deque<ToUpdate>& to_update, Age starting_age);
+  void updateToUpdate(const ToUpdate& u, UpdateQueue& to_update, Age starting_age);
+  /// Tell the listeners about a value that was changed by updating it, its dependencies are handled by the caller
+  void tellOwnChange(const ScriptValueEvent& change);
+  /// The value of the event that tellOwnChange is telling the listeners about
+  const Value* own_change;
   /// Schedule all things in deps to be updated by adding them to to_update
-  void alsoUpdate(deque<ToUpdate>& to_update, const vector<Dependency>& deps, const CardP& card);
+  void alsoUpdate(UpdateQueue& to_update, const vector<Dependency>& deps, const CardP& card);
   
   /// Delayed update for (bitmask)...
   enum Delay
@@ -108,5 +154,7 @@ private:
 protected:
   /// Respond to actions by updating scripts
   void onAction(const Action&, bool undone) override;
+  /// Perform the updates that were postponed during a batch of actions
+  void onEndBatch() override;
 };
 
@@ -47,7 +47,7 @@ ScriptValueP OptionalScript::invoke(Context& ctx, bool open_scope) const {
 
 void OptionalScript::parse(Reader& reader, bool string_mode) {
   vector<ScriptParseError> errors;
-  script = ::parse(unparsed, reader.getPackage(), string_mode, errors);
+  script = parse_cached(unparsed, reader.getPackage(), string_mode, errors);
   // show parse errors as warnings
   String include_warnings;
   for (size_t i = 0 ; i < errors.size() ; ++i) {
@@ -82,6 +82,9 @@ public:
   void initDependencies(Context&, const Dependency& dep) const;
   
   /// Get access to the script, be careful
+  /** Scripts read from files are shared through parse_cached,
+   *  so this should only be used to build a script that was not set.
+   */
   Script& getMutableScript();
   inline ScriptP getScriptP() const { return script; }
   inline void setScriptP(const ScriptP& new_script) { script = new_script; }
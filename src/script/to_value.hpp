@@ -275,15 +275,28 @@ public:
     GetMember gm(name);
     gm.handle(*value);
     if (gm.result()) return gm.result();
-    else {
-      // try nameless member
-      ScriptValueP d = getDefault();
-      if (d) {
-        return d->getMember(name);
-      } else {
-        return ScriptValue::getMember(name);
+    else return getDefaultMember(name);
+  }
+  ScriptValueP getMemberCached(const String& name, MemberCache& cache) const override {
+    if (!member_caches_enabled) return getMember(name);
+    const std::type_info& type = typeid(*value);
+    const char* object = reinterpret_cast<const char*>(&*value);
+    const MemberAccessor* accessor = cache.accessor.load(memory_order_acquire);
+    if (accessor && accessor->type == &type) {
+      // get the member from where we found it last time, without using reflection
+      ScriptValueP member = accessor->get(object + accessor->offset, accessor->index, name);
+      if (member) return member;
+    }
+    GetMember gm(name);
+    gm.handle(*value);
+    if (gm.result()) {
+      MemberAccessor found;
+      if (gm.resultAccessor(object, sizeof(*value), type, found)) {
+        cache.accessor.store(intern_member_accessor(found), memory_order_release);
       }
+      return gm.result();
     }
+    return getDefaultMember(name);
   }
   ScriptValueP getIndex(int index) const override {
     ScriptValueP d = getDefault(); return d ? d->getIndex(index) : ScriptValue::getIndex(index);
@@ -328,6 +341,15 @@ private:
     gdm.handle(*value);
     return gdm.result();
   }
+  /// Get a member of the nameless member, for when the object itself doesn't have it
+  ScriptValueP getDefaultMember(const String& name) const {
+    ScriptValueP d = getDefault();
+    if (d) {
+      return d->getMember(name);
+    } else {
+      return ScriptValue::getMember(name);
+    }
+  }
 };
 
 // ----------------------------------------------------------------------------- : Default arguments / closure
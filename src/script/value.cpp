@@ -69,6 +69,9 @@ ScriptValueP ScriptValue::getMember(const String& name) const {
     return delay_error(ScriptErrorNoMember(typeName(), name));
   }
 }
+ScriptValueP ScriptValue::getMemberCached(const String& name, MemberCache&) const {
+  return getMember(name);
+}
 ScriptValueP ScriptValue::getIndex(int index) const {
   return delay_error(ScriptErrorNoMember(typeName(), String()<<index));
 }
@@ -131,6 +134,25 @@ bool equal(const ScriptValueP& a, const ScriptValueP& b) {
   }
 }
 
+// ----------------------------------------------------------------------------- : Member caches
+
+bool member_caches_enabled = true;
+bool script_value_counting = false;
+atomic<size_t> script_value_count(0);
+
+const MemberAccessor* intern_member_accessor(const MemberAccessor& accessor) {
+  static wxMutex mutex;
+  static map<tuple<const std::type_info*,size_t,int>, vector<unique_ptr<MemberAccessor>>> accessors;
+  wxMutexLocker lock(mutex);
+  // function pointers can only be compared for equality, so the records with the same position are searched
+  auto& same_position = accessors[make_tuple(accessor.type, accessor.offset, accessor.index)];
+  FOR_EACH_CONST(a, same_position) {
+    if (a->get == accessor.get) return a.get();
+  }
+  same_position.push_back(make_unique<MemberAccessor>(accessor));
+  return same_position.back().get();
+}
+
 // ----------------------------------------------------------------------------- : Errors
 
 /// A delayed error message.
@@ -241,7 +263,26 @@ private:
   }
 #endif
 
+// Small integers are very common (counters, indices, results of arithmetic),
+// so preallocated values are used for them instead of allocating a new one each time.
+static const int SMALL_INT_MIN = -128;
+static const int SMALL_INT_MAX = 1023;
+bool small_ints_enabled = true;
+
+// Note: the array is deliberately never freed, to avoid problems with the order of destruction of globals
+static ScriptValueP* make_small_ints() {
+  ScriptValueP* ints = new ScriptValueP[SMALL_INT_MAX - SMALL_INT_MIN + 1];
+  for (int i = SMALL_INT_MIN ; i <= SMALL_INT_MAX ; ++i) {
+    ints[i - SMALL_INT_MIN] = ScriptValueP(new ScriptInt(i));
+  }
+  return ints;
+}
+
 ScriptValueP to_script(int v) {
+  if (v >= SMALL_INT_MIN && v <= SMALL_INT_MAX && small_ints_enabled) {
+    static ScriptValueP* small_ints = make_small_ints();
+    return small_ints[v - SMALL_INT_MIN];
+  }
 #if USE_POOL_ALLOCATOR
   #if USE_INTRUSIVE_PTR
     return ScriptValueP(
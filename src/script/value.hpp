@@ -10,6 +10,7 @@
 
 #include <util/prec.hpp>
 #include <gfx/color.hpp>
+#include <typeinfo>
 class Context;
 class Dependency;
 class ScriptClosure;
@@ -37,6 +38,50 @@ enum ScriptType
 ,  SCRIPT_ERROR
 };
 
+/// How to get a member that was found by reflection directly from an object of a specific type
+/** The member is stored in the object itself, at the same offset in all objects of that type.
+ *  For an item of an IndexMap, the offset is that of the IndexMap, and the item is checked to have the right name,
+ *  since index maps of different objects of the same type can have different keys (for instance cards of different games).
+ *
+ *  Records are interned and never deleted, so they can be shared between threads by pointer.
+ */
+struct MemberAccessor {
+  const std::type_info* type;   ///< Dynamic type of the object
+  size_t                offset; ///< Position of the member in the object, in bytes
+  int                   index;  ///< Position of the item in an IndexMap member, or -1 for other members
+  /// Get the member as a script value, returns nullptr if the IndexMap item has a different name
+  ScriptValueP (*get)(const void* member, int index, const String& name);
+};
+
+/// Intern a MemberAccessor record
+const MemberAccessor* intern_member_accessor(const MemberAccessor& accessor);
+
+/// Inline cache for the member lookup done by a single I_MEMBER_C instruction
+/** Remembers how to get the member from the last type of object it was looked up in.
+ *  The cache is a single atomic pointer, so it can be updated while other threads evaluate the same script.
+ *  Copying a cache gives an empty cache.
+ */
+struct MemberCache {
+  MemberCache() : accessor(nullptr) {}
+  MemberCache(const MemberCache&) : accessor(nullptr) {}
+  
+  atomic<const MemberAccessor*> accessor;
+};
+
+/// Are the MemberCaches used?
+/** Only turned off to compare with looking up all members by reflection, in benchmarks */
+extern bool member_caches_enabled;
+
+/// Are ScriptValue objects counted in script_value_count?
+/** Only turned on in benchmarks, to measure how many values scripts allocate */
+extern bool script_value_counting;
+/// Number of ScriptValue objects created while script_value_counting was on
+extern atomic<size_t> script_value_count;
+
+/// Are preallocated values used for small integers?
+/** Only turned off to compare with allocating all integers, in benchmarks */
+extern bool small_ints_enabled;
+
 enum CompareWhat
 {  COMPARE_NO
 ,  COMPARE_AS_STRING
@@ -47,6 +92,9 @@ enum CompareWhat
 /// Actual values are derived types
 class ScriptValue : public IntrusivePtrBaseWithDelete {
 public:
+  ScriptValue() {
+    if (script_value_counting) script_value_count.fetch_add(1, memory_order_relaxed);
+  }
   virtual ~ScriptValue() {}
 
   /// Information on the type of this value
@@ -77,6 +125,9 @@ public:
 
   /// Get a member variable from this value
   virtual ScriptValueP getMember(const String& name) const;
+  /// Get a member variable from this value, using and updating an inline cache
+  /** By default the cache is ignored */
+  virtual ScriptValueP getMemberCached(const String& name, MemberCache& cache) const;
 
   /// Signal that a script depends on this value itself
   virtual void dependencyThis(const Dependency& dep);
@@ -9,6 +9,7 @@
 #include <util/prec.hpp>
 #include <util/action_stack.hpp>
 #include <util/for_each.hpp>
+#include <util/error.hpp>
 #include <algorithm>
 
 // ----------------------------------------------------------------------------- : Action stack
@@ -16,6 +17,7 @@
 ActionStack::ActionStack()
   : save_point(nullptr)
   , last_was_add(false)
+  , batch_depth(0)
 {}
 
 void ActionStack::addAction(unique_ptr<Action> action, bool allow_merge) {
@@ -111,3 +113,18 @@ void ActionStack::removeListener(ActionListener* listener) {
 void ActionStack::tellListeners(const Action& action, bool undone) {
   FOR_EACH(l, listeners) l->onAction(action, undone);
 }
+
+void ActionStack::beginBatch() {
+  batch_depth++;
+}
+void ActionStack::endBatch() {
+  assert(batch_depth > 0);
+  if (--batch_depth == 0) {
+    FOR_EACH(l, listeners) {
+      // this is called from ~ActionBatch, so don't throw
+      try {
+        l->onEndBatch();
+      } CATCH_ALL_ERRORS(false);
+    }
+  }
+}
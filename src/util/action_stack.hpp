@@ -50,6 +50,8 @@ public:
   virtual ~ActionListener() {}
   /// Notification that an action a has been performed or undone
   virtual void onAction(const Action& a, bool undone) = 0;
+  /// Notification that a batch of actions has ended, see ActionStack::beginBatch
+  virtual void onEndBatch() {}
 };
 
 // ----------------------------------------------------------------------------- : Action stack
@@ -103,6 +105,18 @@ public:
   /// Tell all listeners about an action
   void tellListeners(const Action&, bool undone);
   
+  /// Start a batch of actions
+  /** Listeners are still told about each action, but they may postpone expensive work until the batch ends.
+   *  Batches can be nested, only the end of the outermost batch is reported to listeners.
+   *  Prefer using an ActionBatch object over calling this directly.
+   */
+  void beginBatch();
+  /// End a batch of actions, tells the listeners if this was the outermost batch
+  /** Errors from the listeners are reported with handle_error instead of being thrown. */
+  void endBatch();
+  /// Are we inside a batch of actions?
+  inline bool inBatch() const { return batch_depth > 0; }
+  
 private:
   /// Actions to be undone.
   vector<unique_ptr<Action>> undo_actions;
@@ -114,6 +128,19 @@ private:
   bool last_was_add;
   /// Objects that are listening to actions
   vector<ActionListener*> listeners;
+  /// Number of batches we are in
+  int batch_depth;
+};
+
+/// Performs the actions added during its lifetime as a single batch
+/** For example, when adding many cards one at a time, scripts that depend on all cards are only updated once at the end.
+ */
+class ActionBatch {
+public:
+  inline ActionBatch(ActionStack& stack) : stack(stack) { stack.beginBatch(); }
+  inline ~ActionBatch() { stack.endBatch(); }
+private:
+  ActionStack& stack;
 };
 
 
@@ -68,8 +68,28 @@ private:
 
 // ----------------------------------------------------------------------------- : GetMember
 
+/// Get a member directly from its address, for MemberAccessor
+template <typename T>
+ScriptValueP get_member_at(const void* member, int, const String&) {
+  GetDefaultMember gdm;
+  gdm.handle(*static_cast<const T*>(member));
+  return gdm.result();
+}
+/// Get an item of an IndexMap directly from the address of the map, for MemberAccessor
+template <typename K, typename V>
+ScriptValueP get_index_map_item_at(const void* member, int index, const String& name) {
+  const IndexMap<K,V>& m = *static_cast<const IndexMap<K,V>*>(member);
+  if ((size_t)index >= m.size() || get_key_name(m.at(index)) != name) return ScriptValueP();
+  GetDefaultMember gdm;
+  gdm.handle(m.at(index));
+  return gdm.result();
+}
+
 /// Find a member with a specific name using reflection
-/** The member is wrapped in a ScriptValue */
+/** The member is wrapped in a ScriptValue
+ *
+ *  Also remembers where the member was found, so it can be found again without reflection, see MemberCache.
+ */
 class GetMember {
 public:
   /// Construct a member getter that looks for the given name
@@ -84,6 +104,20 @@ public:
 
   /// The result, or script_nil if the member was not found
   inline ScriptValueP result() { return gdm.result(); } 
+  /// How to get the member that was found from an object of the given type, located at object
+  /** Returns false if the member was not found, or if it is not stored inside that object
+   *  (for instance when it is computed by the reflection code, or stored in another object).
+   */
+  bool resultAccessor(const void* object, size_t object_size, const std::type_info& type, MemberAccessor& out) const {
+    const char* start = static_cast<const char*>(object);
+    const char* found = static_cast<const char*>(found_member);
+    if (!found || found < start || found >= start + object_size) return false;
+    out.type   = &type;
+    out.offset = found - start;
+    out.index  = found_index;
+    out.get    = found_get;
+    return true;
+  }
   
   // --------------------------------------------------- : Handling objects
   
@@ -92,6 +126,8 @@ public:
   void handle(const Char* name, const T& object) {
     if (!gdm.result() && canonical_name_compare(target_name, name)) {
       gdm.handle(object);
+      found_member = &object;
+      found_get    = &get_member_at<T>;
     }
   }
   /// Don't handle a value
@@ -102,9 +138,12 @@ public:
   /// Handle an index map: invistigate keys
   template <typename K, typename V> void handle(const IndexMap<K,V>& m) {
     if (gdm.result()) return;
-    for (typename IndexMap<K,V>::const_iterator it = m.begin() ; it != m.end() ; ++it) {
-      if (get_key_name(*it) == target_name) {
-        gdm.handle(*it);
+    for (size_t i = 0 ; i < m.size() ; ++i) {
+      if (get_key_name(m.at(i)) == target_name) {
+        gdm.handle(m.at(i));
+        found_member = &m;
+        found_index  = (int)i;
+        found_get    = &get_index_map_item_at<K,V>;
         return;
       }
     }
@@ -115,6 +154,10 @@ public:
 private:
   const String& target_name;  ///< The name we are looking for
   GetDefaultMember gdm;    ///< Object to store and retrieve the value
+  // where the member was found, see MemberAccessor
+  const void* found_member = nullptr; ///< The member, or the IndexMap containing it
+  int found_index = -1;               ///< Position in the IndexMap
+  ScriptValueP (*found_get)(const void*, int, const String&) = nullptr;
 };
 
 // ----------------------------------------------------------------------------- : Reflection
@@ -9,7 +9,9 @@
 #include <util/prec.hpp>
 #include <util/io/package.hpp>
 #include <util/io/package_manager.hpp>
+#include <util/io/zip_archive.hpp>
 #include <util/error.hpp>
+#include <util/trace.hpp>
 #include <script/to_value.hpp> // for reflection
 #include <script/profiler.hpp> // for PROFILER
 #include <wx/wfstream.h>
@@ -22,7 +24,8 @@ IMPLEMENT_DYNAMIC_ARG(Package*, writing_package,   nullptr);
 IMPLEMENT_DYNAMIC_ARG(Package*, clipboard_package, nullptr);
 
 Package::Package()
-  : zipStream (nullptr)
+  : contents_pending(false)
+  , zipStream (nullptr)
 {}
 
 Package::~Package() {
@@ -61,8 +64,12 @@ const String& Package::absoluteFilename() const {
 }
 
 void Package::open(const String& n, bool fast) {
+  openLater(n);
+  openContents(fast);
+}
+
+void Package::openLater(const String& n) {
   assert(!isOpened()); // not already opened
-  PROFILER(_("open package"));
   // get absolute path
   wxFileName fn(n);
   fn.Normalize();
@@ -71,6 +78,15 @@ void Package::open(const String& n, bool fast) {
   if (!fn.FileExists() || !fn.GetTimes(0, &modified, 0)) {
     modified = wxDateTime(0.0); // long time ago
   }
+  contents_pending = true;
+}
+
+void Package::openContents(bool fast) {
+  if (!contents_pending) return;
+  wxMutexLocker lock(contents_mutex);
+  if (!contents_pending) return; // opened by another thread while we were waiting
+  PROFILER(_("open package"));
+  TRACE_SCOPE("package", "open package", filename);
   // type of package
   if (wxDirExists(filename)) {
     openDirectory(fast);
@@ -79,12 +95,14 @@ void Package::open(const String& n, bool fast) {
   } else {
     throw PackageNotFoundError(_("Package not found: '") + filename + _("'"));
   }
+  contents_pending = false;
 }
 
 void Package::reopen() {
   if (wxDirExists(filename)) {
     // make sure we have no zip open
     zipStream.reset();
+    zipArchive.reset();
   } else {
     // reopen only needed for zipfile
     openZipfile();
@@ -98,6 +116,8 @@ void Package::save(bool remove_unused) {
 }
 
 void Package::saveAs(const String& name, bool remove_unused, bool as_directory) {
+  TRACE_SCOPE("package", "save package", name);
+  openContents();
   // type of package
   if (wxDirExists(name) || as_directory) {
     saveToDirectory(name, remove_unused, false);
@@ -110,6 +130,8 @@ void Package::saveAs(const String& name, bool remove_unused, bool as_directory)
 }
 
 void Package::saveCopy(const String& name) {
+  TRACE_SCOPE("package", "save package copy", name);
+  openContents();
   saveToZipfile(name, true, true);
   clearKeepFlag();
 }
@@ -187,11 +209,13 @@ public:
 // ----------------------------------------------------------------------------- : Package : inside
 
 unique_ptr<wxInputStream> Package::openIn(const String& file) {
+  TRACE_SCOPE("package", "open file", file);
   if (!file.empty() && file.GetChar(0) == _('/')) {
     // absolute path, open file from another package
     Packaged* p = dynamic_cast<Packaged*>(this);
     return package_manager.openFileFromPackage(p, file).first;
   }
+  openContents();
   FileInfos::iterator it = files.find(normalize_internal_filename(file));
   if (it == files.end()) {
     // does it look like a relative filename?
@@ -203,6 +227,8 @@ unique_ptr<wxInputStream> Package::openIn(const String& file) {
   if (it != files.end() && it->second.wasWritten()) {
     // written to this file, open the temp file
     stream = make_unique<wxFileInputStream>(it->second.tempName);
+  } else if (it != files.end() && zipArchive && (stream = zipArchive->openIn(it->first))) {
+    // a file in a zip archive, read directly from the mapped file
   } else if (wxFileExists(filename+_("/")+file)) {
     // a file in directory package
     stream = make_unique<wxFileInputStream>(filename+_("/")+file);
@@ -226,6 +252,7 @@ unique_ptr<wxOutputStream> Package::openOut(const String& file) {
 
 String Package::nameOut(const String& file) {
   assert(wxThread::IsMain()); // Writing should only be done from the main thread
+  openContents();
   String name = normalize_internal_filename(file);
   FileInfos::iterator it = files.find(name);
   if (it == files.end()) {
@@ -247,6 +274,7 @@ String Package::nameOut(const String& file) {
 
 LocalFileName Package::newFileName(const String& prefix, const String& suffix) {
   assert(wxThread::IsMain()); // Writing should only be done from the main thread
+  openContents();
   String name;
   UInt infix = 0;
   while (true) {
@@ -268,6 +296,7 @@ LocalFileName Package::newFileName(const String& prefix, const String& suffix) {
 
 void Package::referenceFile(const String& file) {
   if (file.empty()) return;
+  openContents();
   FileInfos::iterator it = files.find(file);
   if (it == files.end()) throw InternalError(_("referencing a nonexistant file"));
   it->second.keep = true;
@@ -277,6 +306,7 @@ void Package::referenceFile(const String& file) {
 
 String Package::absoluteName(const LocalFileName& file) {
   assert(wxThread::IsMain());
+  openContents();
   FileInfos::iterator it = files.find(normalize_internal_filename(file.fn));
   if (it == files.end()) {
     throw FileNotFoundError(file.fn, filename);
@@ -397,6 +427,8 @@ void Package::openZipfile() {
   if (!zipStream->IsOk())  throw PackageError(_ERROR_1_("package not found", filename));
   // read zip entries
   loadZipStream();
+  // map the file for reading, if that fails files are read using zipStream
+  zipArchive = ZipArchive::open(filename);
 }
 
 void Package::saveToDirectory(const String& saveAs, bool remove_unused, bool is_copy) {
@@ -444,6 +476,8 @@ void Package::saveToDirectory(const String& saveAs, bool remove_unused, bool is_
 }
 
 void Package::saveToZipfile(const String& saveAs, bool remove_unused, bool is_copy) {
+  // when saving over the same zip file, only write what changed
+  if (!is_copy && saveAs == filename && saveToZipfileIncremental(remove_unused)) return;
   // create a temporary zip file name
   String tempFile = saveAs + _(".tmp");
   remove_file(tempFile);
@@ -474,6 +508,7 @@ void Package::saveToZipfile(const String& saveAs, bool remove_unused, bool is_co
     // close the old file
     if (!is_copy) {
       zipStream.reset();
+      zipArchive.reset();
     }
   } catch (Error const& e) {
     // when things go wrong delete the temp file
@@ -481,17 +516,79 @@ void Package::saveToZipfile(const String& saveAs, bool remove_unused, bool is_co
     throw e;
   }
   // replace the old file with the new file, in effect commiting the changes
+  // note: on windows the old file can still be mapped into memory by another ZipArchive
   if (wxFileExists(saveAs)) {
     // rename old file to .bak
     remove_file(saveAs + _(".bak"));
     wxRenameFile(saveAs, saveAs + _(".bak"));
   }
-  wxRenameFile(tempFile, saveAs);
+  if (!wxRenameFile(tempFile, saveAs)) {
+    // keep using the old file if it is still there, the new one stays in the temp file
+    if (!is_copy && wxFileExists(filename)) openZipfile();
+    throw PackageError(_ERROR_("unable to store file"));
+  }
   // re-open zip file
   filename = saveAs;
   openZipfile();
 }
 
+bool Package::saveToZipfileIncremental(bool remove_unused) {
+  if (!zipArchive || !wxFileExists(filename)) return false;
+  // which files are kept as they are, and which files are written?
+  vector<String> keep;
+  bool changed = false;
+  FOR_EACH(f, files) {
+    if (!f.second.keep && remove_unused) {
+      changed |= f.second.zipEntry != nullptr;
+    } else if (f.second.zipEntry && !f.second.wasWritten()) {
+      keep.push_back(f.first);
+    } else {
+      changed = true;
+    }
+  }
+  if (!changed) return true;
+  // write the changed files to a temporary zip file
+  String tempFile = filename + _(".tmp");
+  remove_file(tempFile);
+  try {
+    {
+      wxFileOutputStream newFile(tempFile);
+      if (!newFile.IsOk()) throw PackageError(_ERROR_("unable to open output file"));
+      wxZipOutputStream newZip(newFile);
+      if (!newZip.IsOk())  throw PackageError(_ERROR_("unable to open output file"));
+      FOR_EACH(f, files) {
+        if ((f.second.keep || !remove_unused) && (!f.second.zipEntry || f.second.wasWritten())) {
+          newZip.PutNextEntry(f.first);
+          auto temp_stream = openIn(f.first);
+          newZip.Write(*temp_stream);
+        }
+      }
+      if (!newZip.Close() || !newFile.Close()) throw PackageError(_ERROR_("unable to store file"));
+    }
+    // append the new entries to the old file
+    ZipArchiveP added = ZipArchive::open(tempFile);
+    if (!added || !zipArchive->append(filename, keep, *added)) {
+      // too much dead space, or something we can't handle: write the whole file
+      added.reset();
+      remove_file(tempFile);
+      return false;
+    }
+  } catch (Error const& e) {
+    remove_file(tempFile);
+    throw e;
+  }
+  remove_file(tempFile);
+  // re-open zip file
+  zipStream.reset();
+  zipArchive.reset();
+  openZipfile();
+  return true;
+}
+
+const Package::FileInfos& Package::getFileInfos() const {
+  const_cast<Package*>(this)->openContents();
+  return files;
+}
 
 Package::FileInfos::iterator Package::addFile(const String& name) {
   return files.insert(make_pair(normalize_internal_filename(name), FileInfo())).first;
@@ -587,6 +684,11 @@ void Packaged::open(const String& package, bool just_header) {
   }
 }
 
+void Packaged::openIndexed(const String& package) {
+  Package::openLater(package);
+  fully_loaded = false;
+}
+
 void Packaged::loadFully() {
   if (fully_loaded) return;
   auto stream = openIn(typeName());
@@ -13,11 +13,13 @@
 #include <util/error.hpp>
 #include <util/file_utils.hpp>
 #include <util/vcs.hpp>
+#include <atomic>
 
 class Package;
 class wxFileInputStream;
 class wxZipInputStream;
 class wxZipEntry;
+DECLARE_POINTER_TYPE(ZipArchive);
 DECLARE_POINTER_TYPE(PackageDependency);
 
 /// The package that is currently being written to
@@ -70,13 +72,12 @@ private:
  *  To accomplish this modified files are first written to temporary files, when save() is called
  *  the temporary files are moved/copied.
  *
- *  Zip files are accessed using wxZip(Input|Output)Stream.
- *  The zip input stream appears to only allow one file at a time, since the stream itself maintains
- *  state about what file we are reading.
- *  There are multiple solutions:
- *    1. (currently used) Open a new ZipInputStream for each file
- *    2. (may be faster) First read the file into a memory buffer,
- *      return a stream based on that buffer (StringInputStream).
+ *  Zip files are read using a ZipArchive, which maps the file into memory once,
+ *  and reads files directly from that memory.
+ *  If the zip file can't be handled that way, a new wxZipInputStream is opened for each file.
+ *  Zip files are written using wxZipOutputStream.
+ *  When saving over the same zip file, only the changed files are written, they are appended to the file
+ *  together with a new central directory. When too much of the file becomes unused, the file is rewritten.
  *
  *  TODO: maybe support sub packages (a package inside another package)?
  */
@@ -113,6 +114,12 @@ public:
    */
   void open(const String& package, bool fast = false);
 
+  /// Open a package, but only read the list of files in it when that is first needed
+  /** Reading the files of a zip package means reading its central directory,
+   *  this can be avoided when only information known from elsewhere is used.
+   */
+  void openLater(const String& package);
+
   /// Saves the package
   /** 
    * By default saves as a zip file, unless it was already a directory.
@@ -207,11 +214,17 @@ protected:
   String filename;
   /// Last modified time
   DateTime modified;
+  /// Has the package been opened with openLater, but the files not yet been read?
+  /** Readers such as openIn are used from worker threads, so the files are read under contents_mutex,
+   *  and this is only cleared once files and zipArchive are filled in.
+   */
+  atomic<bool> contents_pending;
+  wxMutex contents_mutex;
 
 public:
   /// Information on files in the package
   typedef map<String, FileInfo> FileInfos;
-  inline const FileInfos& getFileInfos() const { return files; }
+  const FileInfos& getFileInfos() const;
   /// When was a file last modified?
   DateTime modificationTime(const pair<String, FileInfo>& fi) const;
 private:
@@ -219,8 +232,12 @@ private:
   FileInfos files;
   /// Filestream/zipstream for reading zip files
   unique_ptr<wxZipInputStream> zipStream;
+  /// Memory mapped zip file, for fast reading of the files in it
+  ZipArchiveP zipArchive;
 
   void loadZipStream();
+  /// Read the list of files in the package, if that was postponed by openLater
+  void openContents(bool fast = false);
   void openDirectory(bool fast = false);
   void openSubdir(const String&);
   void openZipfile();
@@ -228,6 +245,8 @@ private:
   void removeTempFiles(bool remove_unused);
   void clearKeepFlag();
   void saveToZipfile(const String&,   bool remove_unused, bool is_copy);
+  /// Save to the same zip file by appending the changed files, returns false if the file should be rewritten instead
+  bool saveToZipfileIncremental(bool remove_unused);
   void saveToDirectory(const String&, bool remove_unused, bool is_copy);
   FileInfos::iterator addFile(const String& file);
 
@@ -276,6 +295,10 @@ public:
   /** if just_header is true, then the package is not fully parsed.
    */
   void open(const String& package, bool just_header = false);
+  /// Open a package of which the header has already been filled in, from the package index
+  /** The package is not parsed, and the files in it are only read when they are needed.
+   */
+  void openIndexed(const String& package);
   /// Ensure the package is fully loaded.
   void loadFully();
   void save();
@@ -33,11 +33,20 @@ void PackageManager::init() {
                 wxStandardPaths::Get().GetUserDataDir());
 }
 void PackageManager::destroy() {
+  local.saveIndex();
+  global.saveIndex();
   loaded_packages.clear();
 }
 void PackageManager::reset() {
   loaded_packages.clear();
 }
+void PackageManager::setLocalDirectory(const String& dir) {
+  if (!wxDirExists(dir)) {
+    throw Error(_("Package directory not found: ") + dir);
+  }
+  local.init(dir);
+  reset();
+}
 
 PackagedP PackageManager::openAny(const String& name_, bool just_header) {
   String name = trim(name_);
@@ -70,7 +79,14 @@ PackagedP PackageManager::openAny(const String& name_, bool just_header) {
     else {
       throw PackageError(_("Unrecognized package type: '") + fn.GetExt() + _("'\nwhile trying to open: ") + name);
     }
-    p->open(filename, just_header);
+    // the header may be known from the package index
+    if (just_header && local.contains(filename)) {
+      local.openHeader(*p, filename);
+    } else if (just_header && global.contains(filename)) {
+      global.openHeader(*p, filename);
+    } else {
+      p->open(filename, just_header);
+    }
   } else if (!just_header) {
     p->loadFully();
   }
@@ -93,6 +109,9 @@ void PackageManager::findMatching(const String& pattern, vector<PackagedP>& out)
     }
     file = wxFindNextFile();
   }
+  // remember new headers for next time
+  local.saveIndex();
+  global.saveIndex();
 }
 
 pair<unique_ptr<wxInputStream>,Packaged*> PackageManager::openFileFromPackage(Packaged* package, const String& name) {
@@ -227,6 +246,7 @@ void PackageDirectory::init(const String& dir) {
     directory = dir;
   else
     directory.clear();
+  index = PackageIndex();
 }
 
 String PackageDirectory::name(const String& name) const {
@@ -242,6 +262,10 @@ String PackageDirectory::findFirstMatching(const String& pattern) const {
   return wxFindFirstFile(directory + _("/") + pattern, 0);
 }
 
+bool PackageDirectory::contains(const String& filename) const {
+  return valid() && wxPathOnly(filename) == normalize_filename(directory);
+}
+
 bool compare_name(const PackageVersionP& a, const PackageVersionP& b) {
   return a->name < b->name;
 }
@@ -353,6 +377,98 @@ String PackageDirectory::databaseFile() {
   return name(_("packages"));
 }
 
+// ----------------------------------------------------------------------------- : PackageDirectory : index
+
+bool compare_index_name(const PackageIndexEntryP& a, const PackageIndexEntryP& b) {
+  return a->name < b->name;
+}
+
+/// Get the modification time and size of the file that contains the header of a package
+/** For zip packages that is the package itself, for directories it is the file in it named after the type,
+ *  for example "style" in "name.mse-style".
+ *  Returns false if there is no such file.
+ */
+bool stat_package_header(const String& filename, DateTime& modified, unsigned int& size) {
+  wxFileName fn(filename);
+  if (wxDirExists(filename)) {
+    String ext = fn.GetExt();
+    if (!starts_with(ext, _("mse-"))) return false;
+    fn = wxFileName(filename, ext.substr(4));
+  }
+  if (!fn.FileExists() || !fn.GetTimes(0, &modified, 0)) return false;
+  wxULongLong file_size = fn.GetSize();
+  if (file_size == wxInvalidSize) return false;
+  size = (unsigned int)file_size.GetLo();
+  return true;
+}
+
+void PackageDirectory::openHeader(Packaged& package, const String& filename) {
+  loadIndex();
+  PackageIndexEntryP key = make_intrusive<PackageIndexEntry>();
+  key->name = filename.substr(filename.find_last_of(_("/\\")) + 1);
+  if (!stat_package_header(filename, key->modified, key->size)) {
+    // not something we can index, just open it
+    package.open(filename, true);
+    return;
+  }
+  auto it = lower_bound(index.packages.begin(), index.packages.end(), key, compare_index_name);
+  if (it != index.packages.end() && (*it)->name == key->name) {
+    const PackageIndexEntry& entry = **it;
+    // the index only stores times in seconds
+    if (entry.size == key->size && entry.modified.GetTicks() == key->modified.GetTicks()) {
+      entry.loadHeader(package);
+      package.openIndexed(filename);
+      return;
+    }
+    index.packages.erase(it);
+  }
+  // read the header, and remember it
+  package.open(filename, true);
+  key->storeHeader(package);
+  index.packages.insert(lower_bound(index.packages.begin(), index.packages.end(), key, compare_index_name), key);
+  index.changed = true;
+}
+
+void PackageDirectory::loadIndex() {
+  if (index.loaded) return;
+  index.loaded = true;
+  String filename = indexFile();
+  if (!valid() || !wxFileExists(filename)) return; // index file not existing is not an error
+  wxFileInputStream file_stream(filename);
+  if (!file_stream.Ok()) return; // failure is not an error
+  try {
+    Reader reader(file_stream, nullptr, filename, true);
+    reader.handle_greedy(index);
+    if (reader.formatVersion() != app_version) {
+      // the headers might be read differently by this version
+      index.packages.clear();
+    }
+  } catch (const Error&) {
+    // a broken index is not an error, the headers are just read again
+    index.packages.clear();
+  }
+  sort(index.packages.begin(), index.packages.end(), compare_index_name);
+}
+
+void PackageDirectory::saveIndex() {
+  if (!index.changed || !valid()) return;
+  index.changed = false;
+  // forget packages that are gone
+  index.packages.erase(remove_if(index.packages.begin(), index.packages.end(), [this](const PackageIndexEntryP& entry) {
+    return !exists(entry->name);
+  }), index.packages.end());
+  // the global directory is often not writable
+  if (!wxFileName::IsDirWritable(directory)) return;
+  wxFileOutputStream stream(indexFile());
+  if (!stream.IsOk()) return;
+  Writer writer(stream, app_version);
+  writer.handle(index);
+}
+
+String PackageDirectory::indexFile() {
+  return name(_("package-index"));
+}
+
 // ----------------------------------------------------------------------------- : PackageDirectory : installing
 
 bool PackageDirectory::install(const InstallablePackage& package) {
@@ -402,6 +518,48 @@ bool PackageDirectory::actual_install(const InstallablePackage& package, const S
   return true;
 }
 
+// ----------------------------------------------------------------------------- : PackageIndex
+
+IMPLEMENT_REFLECTION_NO_SCRIPT(PackageIndexEntry) {
+  REFLECT_NO_SCRIPT(name);
+  REFLECT_NO_SCRIPT(modified);
+  REFLECT_NO_SCRIPT(size);
+  REFLECT_NO_SCRIPT(version);
+  REFLECT_NO_SCRIPT(compatible_version);
+  REFLECT_NO_SCRIPT(installer_group);
+  REFLECT_NO_SCRIPT(short_name);
+  REFLECT_NO_SCRIPT(full_name);
+  REFLECT_NO_SCRIPT_N("icon", icon_filename);
+  REFLECT_NO_SCRIPT(position_hint);
+  REFLECT_NO_SCRIPT_N("depends_ons", dependencies); // hack for singular_form
+}
+
+IMPLEMENT_REFLECTION_NO_SCRIPT(PackageIndex) {
+  REFLECT_NO_SCRIPT(packages);
+}
+
+void PackageIndexEntry::storeHeader(const Packaged& package) {
+  version            = package.version;
+  compatible_version = package.compatible_version;
+  installer_group    = package.installer_group;
+  short_name         = package.short_name;
+  full_name          = package.full_name;
+  icon_filename      = package.icon_filename;
+  dependencies       = package.dependencies;
+  position_hint      = package.position_hint;
+}
+
+void PackageIndexEntry::loadHeader(Packaged& package) const {
+  package.version            = version;
+  package.compatible_version = compatible_version;
+  package.installer_group    = installer_group;
+  package.short_name         = short_name;
+  package.full_name          = full_name;
+  package.icon_filename      = icon_filename;
+  package.dependencies       = dependencies;
+  package.position_hint      = position_hint;
+}
+
 // ----------------------------------------------------------------------------- : PackageVersion
 
 template <> void Writer::handle(const PackageVersion::FileInfo& f) {
@@ -15,6 +15,7 @@
 DECLARE_POINTER_TYPE(Packaged);
 DECLARE_POINTER_TYPE(PackageVersion);
 DECLARE_POINTER_TYPE(InstallablePackage);
+DECLARE_POINTER_TYPE(PackageIndexEntry);
 class PackageDependency;
 
 // ----------------------------------------------------------------------------- : PackageVersion
@@ -54,6 +55,51 @@ IMPLEMENT_REFLECTION_NO_SCRIPT(UpdateData) {
 }
 */
 
+// ----------------------------------------------------------------------------- : PackageIndex
+
+/// The header of a package, as remembered in the package index
+class PackageIndexEntry : public IntrusivePtrBase<PackageIndexEntry> {
+public:
+  PackageIndexEntry() : size(0), position_hint(0) {}
+  
+  String       name;              ///< Filename of the package, relative to the package directory
+  DateTime     modified;          ///< Modification time of the file containing the header
+  unsigned int size;              ///< Size of the file containing the header
+  // the header of the package
+  Version      version;
+  Version      compatible_version;
+  String       installer_group;
+  String       short_name;
+  String       full_name;
+  String       icon_filename;
+  vector<PackageDependencyP> dependencies;
+  int          position_hint;
+  
+  /// Copy the header from a package
+  void storeHeader(const Packaged& package);
+  /// Copy the header to a package
+  void loadHeader(Packaged& package) const;
+  
+  DECLARE_REFLECTION();
+};
+
+/// Index of the headers of the packages in a directory
+/** Reading the header of a package means opening it and parsing the file in it,
+ *  with the index listing many packages only takes a single file read.
+ *  Entries are checked against the modification time and size of the package file,
+ *  or of the header file for packages that are directories.
+ */
+class PackageIndex {
+public:
+  PackageIndex() : loaded(false), changed(false) {}
+  
+  vector<PackageIndexEntryP> packages; ///< sorted by name
+  bool loaded;  ///< Has the index been read from disk?
+  bool changed; ///< Does the index need to be written to disk?
+  
+  DECLARE_REFLECTION();
+};
+
 // ----------------------------------------------------------------------------- : PackageDirectory
 
 /// A directory for packages
@@ -74,6 +120,14 @@ public:
   
   /// Find all packages that match a filename pattern (using wxFindFirst)
   String findFirstMatching(const String& pattern) const;
+  /// Is the package with the given (normalized) filename in this directory?
+  bool contains(const String& filename) const;
+  
+  /// Open the header of a package in this directory, with the package index if it is up to date
+  /** The package should be newly constructed, of the right type. */
+  void openHeader(Packaged& package, const String& filename);
+  /// Write the package index, if it has changed
+  void saveIndex();
   
   /// Get all installed packages
   void installedPackages(vector<InstallablePackageP>& packages);
@@ -92,8 +146,11 @@ private:
   bool   is_local;
   String directory;
   vector<PackageVersionP> packages; // sorted by name
+  PackageIndex index;
   
   String databaseFile();
+  String indexFile();
+  void loadIndex();
   // Do the actual installation of a package
   bool actual_install(const InstallablePackage& package, const String& install_dir);
   
@@ -116,6 +173,11 @@ public:
   void destroy();
   /// Empty the list of packages, they will all be reloaded
   void reset();
+  /// Look for packages in the given directory instead of the user's local data directory
+  /** For running with a fixed set of packages, like the benchmark fixtures.
+   *  Packages not found there are still looked for in the global data directory.
+   */
+  void setLocalDirectory(const String& dir);
   
   // --------------------------------------------------- : Packages in memory
   
@@ -0,0 +1,328 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <util/io/zip_archive.hpp>
+#include <util/file_utils.hpp>
+#include <wx/mstream.h>
+#include <wx/zstream.h>
+#include <wx/file.h>
+#if defined(__WXMSW__)
+  #include <io.h>
+#else
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+
+// ----------------------------------------------------------------------------- : Memory mapping
+
+/// Map a whole file into memory, read only
+/** Returns false if that fails, or if the file is empty */
+bool map_file(const String& filename, const unsigned char*& data, size_t& size) {
+  #if defined(__WXMSW__)
+    // the mapping keeps the file open, allow writing so ZipArchive::append can add to the file,
+    // and deleting so a new file can be renamed over it when the package is saved in full
+    HANDLE file = ::CreateFileW(filename.wc_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER file_size;
+    if (!::GetFileSizeEx(file, &file_size) || file_size.QuadPart <= 0 || (ULONGLONG)file_size.QuadPart > (size_t)-1) {
+      ::CloseHandle(file);
+      return false;
+    }
+    HANDLE mapping = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    ::CloseHandle(file); // the mapping keeps the file open
+    if (!mapping) return false;
+    void* view = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    ::CloseHandle(mapping); // the view keeps the mapping alive
+    if (!view) return false;
+    data = static_cast<const unsigned char*>(view);
+    size = (size_t)file_size.QuadPart;
+    return true;
+  #else
+    int fd = ::open(filename.fn_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+      ::close(fd);
+      return false;
+    }
+    void* view = ::mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file open
+    if (view == MAP_FAILED) return false;
+    data = static_cast<const unsigned char*>(view);
+    size = (size_t)st.st_size;
+    return true;
+  #endif
+}
+
+void unmap_file(const unsigned char* data, size_t size) {
+  #if defined(__WXMSW__)
+    ::UnmapViewOfFile(data);
+  #else
+    ::munmap(const_cast<unsigned char*>(data), size);
+  #endif
+}
+
+/// Cut an open file back to the given size
+/** The mapped part of the file must not be cut off */
+bool truncate_file(wxFile& file, size_t size) {
+  #if defined(__WXMSW__)
+    return _chsize_s(file.fd(), (__int64)size) == 0;
+  #else
+    return ::ftruncate(file.fd(), (off_t)size) == 0;
+  #endif
+}
+
+// ----------------------------------------------------------------------------- : Zip format
+
+// Signatures and sizes of the zip structures we use
+const UInt ZIP_LOCAL_HEADER_SIGNATURE = 0x04034b50;
+const UInt ZIP_CENTRAL_HEADER_SIGNATURE = 0x02014b50;
+const UInt ZIP_END_OF_DIRECTORY_SIGNATURE = 0x06054b50;
+const UInt ZIP_DESCRIPTOR_SIGNATURE = 0x08074b50;
+const size_t ZIP_LOCAL_HEADER_SIZE = 30;
+const size_t ZIP_CENTRAL_HEADER_SIZE = 46;
+const size_t ZIP_END_OF_DIRECTORY_SIZE = 22;
+const size_t ZIP_MAX_COMMENT_SIZE = 0xFFFF;
+const size_t ZIP_DESCRIPTOR_SIZE = 12; // without the optional signature
+
+// Flags and compression methods
+const UInt ZIP_FLAG_ENCRYPTED = 0x0001;
+const UInt ZIP_FLAG_DESCRIPTOR = 0x0008;
+const UInt ZIP_FLAG_UTF8 = 0x0800;
+const UInt ZIP_METHOD_STORED = 0;
+const UInt ZIP_METHOD_DEFLATED = 8;
+
+// zip files are little endian
+inline UInt read_u16(const unsigned char* p) {
+  return p[0] | (p[1] << 8);
+}
+inline UInt read_u32(const unsigned char* p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((UInt)p[3] << 24);
+}
+inline void write_u16(unsigned char* p, UInt x) {
+  p[0] = x & 0xFF; p[1] = (x >> 8) & 0xFF;
+}
+inline void write_u32(unsigned char* p, UInt x) {
+  p[0] = x & 0xFF; p[1] = (x >> 8) & 0xFF; p[2] = (x >> 16) & 0xFF; p[3] = (x >> 24) & 0xFF;
+}
+
+// ----------------------------------------------------------------------------- : Streams
+
+/// Stream for a file stored without compression, reads directly from the mapped memory
+class ZipArchiveStoredStream : public wxMemoryInputStream {
+public:
+  ZipArchiveStoredStream(const ZipArchiveP& archive, const unsigned char* data, size_t size)
+    : wxMemoryInputStream(data, size)
+    , archive(archive)
+  {}
+private:
+  ZipArchiveP archive; ///< Keep the archive mapped
+};
+
+/// Class to use as a superclass, so the compressed stream is constructed first
+class ZipArchiveInflateStream_aux {
+protected:
+  ZipArchiveP         archive;    ///< Keep the archive mapped
+  wxMemoryInputStream compressed; ///< The compressed data in the mapped memory
+  inline ZipArchiveInflateStream_aux(const ZipArchiveP& archive, const unsigned char* data, size_t size)
+    : archive(archive)
+    , compressed(data, size)
+  {}
+};
+
+/// Stream for a deflated file, inflates from the mapped memory
+class ZipArchiveInflateStream : private ZipArchiveInflateStream_aux, public wxZlibInputStream {
+public:
+  ZipArchiveInflateStream(const ZipArchiveP& archive, const unsigned char* data, size_t compressed_size, size_t size)
+    : ZipArchiveInflateStream_aux(archive, data, compressed_size)
+    , wxZlibInputStream(compressed, wxZLIB_NO_HEADER)
+    , size(size)
+  {}
+  wxFileOffset GetLength() const override {
+    return size;
+  }
+private:
+  size_t size; ///< Size of the inflated file
+};
+
+// ----------------------------------------------------------------------------- : ZipArchive
+
+ZipArchive::ZipArchive(const unsigned char* data, size_t size)
+  : data(data), size(size)
+{}
+
+ZipArchive::~ZipArchive() {
+  unmap_file(data, size);
+}
+
+ZipArchiveP ZipArchive::open(const String& filename) {
+  const unsigned char* data;
+  size_t size;
+  if (!map_file(filename, data, size)) return ZipArchiveP();
+  ZipArchiveP archive(new ZipArchive(data, size));
+  if (!archive->readCentralDirectory()) return ZipArchiveP();
+  return archive;
+}
+
+bool ZipArchive::readCentralDirectory() {
+  // find the end of central directory record, it is followed by a comment of at most 64KB
+  if (size < ZIP_END_OF_DIRECTORY_SIZE) return false;
+  size_t end = size - ZIP_END_OF_DIRECTORY_SIZE;
+  size_t first = end > ZIP_MAX_COMMENT_SIZE ? end - ZIP_MAX_COMMENT_SIZE : 0;
+  while (read_u32(data + end) != ZIP_END_OF_DIRECTORY_SIGNATURE) {
+    if (end == first) return false;
+    --end;
+  }
+  const unsigned char* eocd = data + end;
+  UInt   disk        = read_u16(eocd + 4);
+  UInt   dir_disk    = read_u16(eocd + 6);
+  UInt   count       = read_u16(eocd + 10);
+  size_t dir_size    = read_u32(eocd + 12);
+  size_t dir_offset  = read_u32(eocd + 16);
+  if (disk != 0 || dir_disk != 0) return false; // multiple disks
+  if (count == 0xFFFF || dir_offset == 0xFFFFFFFF) return false; // zip64
+  if (dir_offset > end || dir_size > end - dir_offset) return false;
+  // read the central directory
+  const unsigned char* p = data + dir_offset;
+  const unsigned char* dir_end = p + dir_size;
+  for (UInt i = 0 ; i < count ; ++i) {
+    if (dir_end - p < (ptrdiff_t)ZIP_CENTRAL_HEADER_SIZE) return false;
+    if (read_u32(p) != ZIP_CENTRAL_HEADER_SIGNATURE) return false;
+    UInt   flags         = read_u16(p + 8);
+    UInt   method        = read_u16(p + 10);
+    size_t name_size     = read_u16(p + 28);
+    size_t extra_size    = read_u16(p + 30);
+    size_t comment_size  = read_u16(p + 32);
+    Entry entry;
+    entry.central_offset  = p - data;
+    entry.central_size    = ZIP_CENTRAL_HEADER_SIZE + name_size + extra_size + comment_size;
+    entry.compressed_size = read_u32(p + 20);
+    entry.size            = read_u32(p + 24);
+    entry.header_offset   = read_u32(p + 42);
+    entry.deflated        = method == ZIP_METHOD_DEFLATED;
+    entry.descriptor      = (flags & ZIP_FLAG_DESCRIPTOR) != 0;
+    const unsigned char* name = p + ZIP_CENTRAL_HEADER_SIZE;
+    p = name + name_size + extra_size + comment_size;
+    if (p > dir_end) return false;
+    if (flags & ZIP_FLAG_ENCRYPTED) return false;
+    if (method != ZIP_METHOD_STORED && method != ZIP_METHOD_DEFLATED) return false;
+    if (entry.compressed_size == 0xFFFFFFFF || entry.size == 0xFFFFFFFF || entry.header_offset == 0xFFFFFFFF) return false; // zip64
+    // file names are in the local encoding, unless the utf8 flag is set (same as wxZipInputStream)
+    String entry_name((const char*)name, flags & ZIP_FLAG_UTF8 ? (const wxMBConv&)wxConvUTF8 : (const wxMBConv&)wxConvLocal, name_size);
+    entries[normalize_internal_filename(entry_name)] = entry;
+  }
+  return true;
+}
+
+unique_ptr<wxInputStream> ZipArchive::openIn(const String& name) {
+  auto it = entries.find(name);
+  if (it == entries.end()) return nullptr;
+  const Entry& entry = it->second;
+  size_t start = dataOffset(entry);
+  if (!start) return nullptr;
+  if (entry.deflated) {
+    return make_unique<ZipArchiveInflateStream>(intrusive_from_this(), data + start, entry.compressed_size, entry.size);
+  } else {
+    return make_unique<ZipArchiveStoredStream>(intrusive_from_this(), data + start, entry.compressed_size);
+  }
+}
+
+size_t ZipArchive::dataOffset(const Entry& entry) const {
+  // the data comes after the local header, which has its own name and extra fields
+  if (entry.header_offset > size || size - entry.header_offset < ZIP_LOCAL_HEADER_SIZE) return 0;
+  const unsigned char* header = data + entry.header_offset;
+  if (read_u32(header) != ZIP_LOCAL_HEADER_SIGNATURE) return 0;
+  size_t start = entry.header_offset + ZIP_LOCAL_HEADER_SIZE + read_u16(header + 26) + read_u16(header + 28);
+  if (start > size || size - start < entry.compressed_size) return 0;
+  return start;
+}
+
+size_t ZipArchive::localSize(const Entry& entry) const {
+  size_t start = dataOffset(entry);
+  if (!start) return 0;
+  size_t end = start + entry.compressed_size;
+  if (entry.descriptor) {
+    if (size - end < ZIP_DESCRIPTOR_SIZE) return 0;
+    end += ZIP_DESCRIPTOR_SIZE;
+    if (read_u32(data + end - ZIP_DESCRIPTOR_SIZE) == ZIP_DESCRIPTOR_SIGNATURE) {
+      if (size - end < 4) return 0;
+      end += 4;
+    }
+  }
+  return end - entry.header_offset;
+}
+
+// ----------------------------------------------------------------------------- : ZipArchive : appending
+
+bool ZipArchive::append(const String& filename, const vector<String>& keep, const ZipArchive& added) const {
+  // build the new central directory
+  // kept entries stay where they are, added entries are placed after the end of the current file
+  vector<unsigned char> directory;
+  size_t live_size = 0;  // size of the entries of this archive that are kept
+  size_t added_size = 0; // size of the added entries
+  UInt count = 0;
+  FOR_EACH_CONST(name, keep) {
+    auto it = entries.find(name);
+    if (it == entries.end()) return false;
+    const Entry& entry = it->second;
+    size_t local_size = localSize(entry);
+    if (!local_size) return false;
+    live_size += local_size;
+    directory.insert(directory.end(), data + entry.central_offset, data + entry.central_offset + entry.central_size);
+    ++count;
+  }
+  vector<pair<size_t,size_t>> added_records; // (offset,size) in added
+  FOR_EACH_CONST(e, added.entries) {
+    const Entry& entry = e.second;
+    size_t local_size = added.localSize(entry);
+    if (!local_size) return false;
+    size_t pos = directory.size();
+    directory.insert(directory.end(), added.data + entry.central_offset, added.data + entry.central_offset + entry.central_size);
+    size_t new_offset = size + added_size;
+    if (new_offset >= 0xFFFFFFFF) return false;
+    write_u32(&directory[pos + 42], (UInt)new_offset);
+    added_records.push_back(make_pair(entry.header_offset, local_size));
+    added_size += local_size;
+    ++count;
+  }
+  // would the result have too much dead space? Then the file should be compacted by rewriting it.
+  // dead space comes from replaced and removed entries, and from old central directories
+  size_t new_size = size + added_size + directory.size() + ZIP_END_OF_DIRECTORY_SIZE;
+  size_t dead_size = size - live_size;
+  if (dead_size > new_size / MAX_DEAD_FRACTION) return false;
+  if (count >= 0xFFFF || new_size >= 0xFFFFFFFF) return false; // would need zip64
+  // end of central directory record
+  unsigned char end[ZIP_END_OF_DIRECTORY_SIZE] = {0};
+  write_u32(end,      ZIP_END_OF_DIRECTORY_SIGNATURE);
+  write_u16(end + 8,  count);
+  write_u16(end + 10, count);
+  write_u32(end + 12, (UInt)directory.size());
+  write_u32(end + 16, (UInt)(size + added_size));
+  // append everything to the file
+  wxFile file(filename, wxFile::write_append);
+  if (!file.IsOpened() || file.Length() != (wxFileOffset)size) return false;
+  bool ok = true;
+  FOR_EACH_CONST(r, added_records) {
+    ok = ok && file.Write(added.data + r.first, r.second) == r.second;
+  }
+  ok = ok && file.Write(directory.data(), directory.size()) == directory.size();
+  ok = ok && file.Write(end, sizeof(end)) == sizeof(end);
+  ok = ok && file.Flush();
+  if (!ok) {
+    // remove what was written, otherwise the old end of central directory can't be found anymore
+    truncate_file(file, size);
+    file.Flush();
+    file.Close();
+    throw PackageError(_ERROR_("unable to store file"));
+  }
+  if (!file.Close()) throw PackageError(_ERROR_("unable to store file"));
+  return true;
+}
@@ -0,0 +1,79 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#pragma once
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+
+DECLARE_POINTER_TYPE(ZipArchive);
+
+// ----------------------------------------------------------------------------- : ZipArchive
+
+/// A zip file that is read through a memory mapping
+/** The central directory is read once, when the archive is opened.
+ *  Files stored without compression are read directly from the mapped memory,
+ *  deflated files are inflated from it. There is no need to open or seek in the file for each read.
+ *
+ *  After opening the archive doesn't change, so files can be read from multiple threads.
+ *  Streams returned by openIn keep the archive mapped.
+ */
+class ZipArchive : public IntrusivePtrBase<ZipArchive>, public IntrusiveFromThis<ZipArchive> {
+public:
+  ~ZipArchive();
+
+  /// Map and index a zip file
+  /** Returns nullptr if the file can not be mapped, or if it uses zip features we don't support
+   *  (zip64, encryption, multiple disks, compression other than deflate).
+   *  In that case the caller should fall back to wxZipInputStream.
+   */
+  static ZipArchiveP open(const String& filename);
+
+  /// Open a file in the archive, by normalized name
+  /** Returns nullptr if the file is not in the archive or if it is damaged */
+  unique_ptr<wxInputStream> openIn(const String& name);
+
+  /// Update the zip file of this archive by appending entries and a new central directory
+  /** The new central directory lists the entries of this archive with the (normalized) names in keep,
+   *  and all entries of added, which are copied without recompressing them.
+   *  Entries of this archive that are not kept remain in the file as dead space.
+   *
+   *  Returns false without changing the file if that is not possible,
+   *  or if more than 1/MAX_DEAD_FRACTION of the file would be dead space.
+   *  Then the file should be compacted by writing it anew.
+   *  Throws if writing fails, after cutting the file back to its old size.
+   */
+  bool append(const String& filename, const vector<String>& keep, const ZipArchive& added) const;
+
+  /// Maximum fraction of dead space in a zip file that is saved incrementally
+  static const size_t MAX_DEAD_FRACTION = 4;
+
+private:
+  ZipArchive(const unsigned char* data, size_t size);
+
+  /// Information on a file in the archive, from the central directory
+  struct Entry {
+    size_t header_offset;   ///< Position of the local file header
+    size_t compressed_size; ///< Size of the data in the archive
+    size_t size;            ///< Size of the file after decompression
+    bool   deflated;        ///< Is the file compressed with deflate? Otherwise it is stored
+    bool   descriptor;      ///< Is the data followed by a data descriptor?
+    size_t central_offset;  ///< Position of the record in the central directory
+    size_t central_size;    ///< Size of the record in the central directory
+  };
+
+  const unsigned char* data; ///< The mapped file
+  size_t               size; ///< Size of the mapped file
+  map<String,Entry>    entries;
+
+  /// Read the central directory, returns false if it is not supported
+  bool readCentralDirectory();
+  /// Position of the data of an entry, or 0 if the entry is damaged
+  size_t dataOffset(const Entry& entry) const;
+  /// Size of the local header, data and data descriptor of an entry, or 0 if the entry is damaged
+  size_t localSize(const Entry& entry) const;
+};
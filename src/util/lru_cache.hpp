@@ -0,0 +1,83 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#pragma once
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <wx/thread.h>
+#include <list>
+
+// ----------------------------------------------------------------------------- : LruCache
+
+/// A map of bounded size, that forgets the least recently used items when it is full
+/** Each item has a cost, by default 1, so the capacity is either a number of items or for instance a number of bytes.
+ *  Values are copied in and out, so a large value is best stored behind a (shared) pointer.
+ *
+ *  The cache can be used from multiple threads.
+ */
+template <typename K, typename V>
+class LruCache {
+public:
+  explicit LruCache(size_t capacity)
+    : capacity(capacity), total(0)
+  {}
+
+  /// Find the value for a key, and mark it as recently used
+  bool find(const K& key, V& value_out) {
+    wxMutexLocker lock(mutex);
+    auto it = index.find(key);
+    if (it == index.end()) return false;
+    items.splice(items.begin(), items, it->second);
+    value_out = it->second->value;
+    return true;
+  }
+  /// Add or replace the value for a key, forgetting the least recently used items to make room
+  /** Items that cost more than the whole capacity are not stored. */
+  void store(const K& key, const V& value, size_t cost = 1) {
+    wxMutexLocker lock(mutex);
+    auto it = index.find(key);
+    if (it != index.end()) {
+      total -= it->second->cost;
+      items.erase(it->second);
+      index.erase(it);
+    }
+    if (cost > capacity) return;
+    while (total + cost > capacity) {
+      total -= items.back().cost;
+      index.erase(*items.back().key);
+      items.pop_back();
+    }
+    it = index.emplace(key, items.end()).first;
+    items.push_front(Item{&it->first, value, cost});
+    it->second = items.begin();
+    total += cost;
+  }
+  /// Forget all items
+  void clear() {
+    wxMutexLocker lock(mutex);
+    items.clear();
+    index.clear();
+    total = 0;
+  }
+  /// Number of items in the cache
+  size_t size() {
+    wxMutexLocker lock(mutex);
+    return items.size();
+  }
+
+private:
+  struct Item {
+    const K* key; ///< The key in index, which doesn't move
+    V        value;
+    size_t   cost;
+  };
+  wxMutex mutex;
+  list<Item> items; ///< Most recently used first
+  map<K, typename list<Item>::iterator> index;
+  size_t capacity, total;
+};
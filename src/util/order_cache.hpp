@@ -9,11 +9,18 @@
 // ----------------------------------------------------------------------------- : Includes
 
 #include <util/prec.hpp>
+#include <unordered_map>
+#include <unordered_set>
 
 // ----------------------------------------------------------------------------- : OrderCache
 
 /// Object that cashes an ordered version of a list of items, for finding the position of objects
-/** Can be used as a map "void* -> int" for finding the position of an object */
+/** Can be used as a map "void* -> int" for finding the position of an object.
+ *
+ *  The cache can be kept up to date when the values of some items change:
+ *  invalidate those items, and later update or remove them.
+ *  Items with equal values are ordered by when they were added to the cache.
+ */
 template <typename T>
 class OrderCache : public IntrusivePtrBase<OrderCache<T>> {
 public:
@@ -25,60 +32,117 @@ public:
   
   /// Find the position of the given key in the cache, returns -1 if not found
   int find(const T& key) const;
+  /// Number of items that are kept
+  inline int count() const { return (int)order.size(); }
+  
+  /// Indicate that the value of a key may have changed, or that the key may have been added or removed
+  void invalidate(const T& key);
+  /// The keys that were invalidated, these should be updated or removed
+  inline const vector<T>& invalidated() const { return dirty; }
+  /// Forget about the invalidated keys
+  void clearInvalidated();
+  /// Set the value of a key, adds the key if it is not in the cache
+  void update(const T& key, const String& value, bool keep);
+  /// Remove a key from the cache
+  void remove(const T& key);
   
 private:
-  struct CompareKeys;
-  struct CompareValues;
-  typedef pair<void*,int> KV;
-  vector<KV> positions;
+  struct Item {
+    String value;
+    size_t seq;  ///< Order in which items were added
+    bool   keep;
+  };
+  struct Entry {
+    const Item* item;
+    const void* key;
+  };
+  struct CompareEntries;
+  unordered_map<const void*,Item> items; ///< All items, by key
+  vector<Entry> order;                   ///< The kept items, in order
+  vector<T> dirty;                       ///< Invalidated keys
+  unordered_set<const void*> dirty_keys;
+  size_t next_seq;
+  
+  typename vector<Entry>::iterator findEntry(const Item& item);
 };
 
 // ----------------------------------------------------------------------------- : Implementation
 
 template <typename T>
-struct OrderCache<T>::CompareKeys {
-  inline bool operator () (const KV& a, void*     b) { return a.first < b; }
-  inline bool operator () (const KV& a, const KV& b) { return a.first < b.first; }
-  inline bool operator () (void*     a, const KV& b) { return a       < b.first; }
-};
-
-template <typename T>
-struct OrderCache<T>::CompareValues {
-  const vector<String>& values;
-  CompareValues(const vector<String>& values) : values(values) {}
-  
-  inline bool operator () (const KV& a, const KV& b) {
-    return smart_less(values[a.second], values[b.second]);
+struct OrderCache<T>::CompareEntries {
+  inline bool operator () (const Entry& a, const Entry& b) const {
+    if (smart_less(a.item->value, b.item->value)) return true;
+    if (smart_less(b.item->value, a.item->value)) return false;
+    return a.item->seq < b.item->seq;
   }
 };
 
 template <typename T>
-OrderCache<T>::OrderCache(const vector<T>& keys, const vector<String>& values, vector<int>* keep) {
+OrderCache<T>::OrderCache(const vector<T>& keys, const vector<String>& values, vector<int>* keep)
+  : next_seq(keys.size())
+{
   assert(keys.size() == values.size());
   assert(!keep || keep->size() == keys.size());
-  // initialize positions, use pos to point back to the values vector
-  positions.reserve(keys.size());
-  int i = 0;
-  for (typename vector<T>::const_iterator it = keys.begin() ; it != keys.end() ; ++it, ++i) {
-    if (!keep || (*keep)[i]) {
-      positions.push_back(KV(&**it, i));
-    }
+  items.reserve(keys.size());
+  order.reserve(keys.size());
+  for (size_t i = 0 ; i < keys.size() ; ++i) {
+    Item& item = items[&*keys[i]];
+    item.value = values[i];
+    item.seq   = i;
+    item.keep  = !keep || (*keep)[i];
+    if (item.keep) order.push_back(Entry{&item, &*keys[i]});
   }
-  // sort the KVs by the values
-  sort(positions.begin(), positions.end(), CompareValues(values));
-  // update positions, to point to sorted list
-  i = 0;
-  for (typename vector<KV>::iterator it = positions.begin() ; it != positions.end() ; ++it, ++i) {
-    it->second = i;
-  }
-  // sort the KVs by the keys
-  sort(positions.begin(), positions.end(), CompareKeys());
+  // sort the kept items by their values, note: pointers to items in an unordered_map stay valid
+  sort(order.begin(), order.end(), CompareEntries());
 }
 
 template <typename T>
 int OrderCache<T>::find(const T& key) const {
-  vector<KV>::const_iterator it = lower_bound(positions.begin(), positions.end(), &*key, CompareKeys());
-  if (it == positions.end() || it->first != &*key) return -1;
-  return it->second;
+  auto it = items.find(&*key);
+  if (it == items.end() || !it->second.keep) return -1;
+  auto pos = lower_bound(order.begin(), order.end(), Entry{&it->second, &*key}, CompareEntries());
+  return (int)(pos - order.begin());
+}
+
+template <typename T>
+typename vector<typename OrderCache<T>::Entry>::iterator OrderCache<T>::findEntry(const Item& item) {
+  return lower_bound(order.begin(), order.end(), Entry{&item, nullptr}, CompareEntries());
 }
 
+template <typename T>
+void OrderCache<T>::invalidate(const T& key) {
+  if (dirty_keys.insert(&*key).second) {
+    dirty.push_back(key);
+  }
+}
+
+template <typename T>
+void OrderCache<T>::clearInvalidated() {
+  dirty.clear();
+  dirty_keys.clear();
+}
+
+template <typename T>
+void OrderCache<T>::update(const T& key, const String& value, bool keep) {
+  auto it = items.find(&*key);
+  Item* item;
+  if (it == items.end()) {
+    item = &items[&*key];
+    item->seq = next_seq++;
+  } else {
+    item = &it->second;
+    if (item->keep == keep && item->value == value) return; // no change
+    if (item->keep) order.erase(findEntry(*item));
+  }
+  item->value = value;
+  item->keep  = keep;
+  if (keep) order.insert(findEntry(*item), Entry{item, &*key});
+}
+
+template <typename T>
+void OrderCache<T>::remove(const T& key) {
+  auto it = items.find(&*key);
+  if (it == items.end()) return;
+  if (it->second.keep) order.erase(findEntry(it->second));
+  items.erase(it);
+}
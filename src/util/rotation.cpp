@@ -10,6 +10,7 @@
 #include <util/rotation.hpp>
 #include <gfx/gfx.hpp>
 #include <data/font.hpp>
+#include <util/lru_cache.hpp>
 
 // ----------------------------------------------------------------------------- : Rotation
 
@@ -349,6 +350,52 @@ RealSize RotatedDC::GetTextExtent(const String& text) const {
     return RealSize(w / (zoomX * text_scaling), h / (zoomY * text_scaling));
   }
 }
+/// Text extents in device units, as measured by GetPartialTextExtents
+struct DeviceTextExtents {
+  wxArrayInt widths;
+  int w, h;
+};
+
+/// Cache of text extents, by font and text
+/** The cache is shared by all dcs, and can be used from multiple threads */
+LruCache<String,DeviceTextExtents> text_extent_cache(10000);
+
+/// Measure text with the font of dc, or get the measurement from the cache
+DeviceTextExtents cached_text_extents(wxDC& dc, const String& text) {
+  wxFont font = dc.GetFont();
+  wxSize ppi = dc.GetPPI();
+  String key = font.GetNativeFontInfoDesc() << _('/') << font.GetPointSize() << _('/') << ppi.x << _('/') << ppi.y << _('\n') << text;
+  DeviceTextExtents ext;
+  if (text_extent_cache.find(key, ext)) return ext;
+  dc.GetPartialTextExtents(text, ext.widths);
+  dc.GetTextExtent(text, &ext.w, &ext.h);
+  #ifdef __WXGTK__
+    // HACK: Some fonts don't get the descender height set correctly, see GetTextExtent
+    int charHeight = dc.GetCharHeight();
+    if (charHeight != ext.h)
+      ext.h += ext.h - charHeight;
+  #endif
+  text_extent_cache.store(key, ext);
+  return ext;
+}
+
+void clear_text_extent_cache() {
+  text_extent_cache.clear();
+}
+
+RealSize RotatedDC::GetPartialTextExtents(const String& text, vector<double>& widths) const {
+  widths.clear();
+  if (text.empty()) return RealSize(0, GetCharHeight());
+  double sx = quality == QUALITY_LOW ? zoomX : zoomX * text_scaling;
+  double sy = quality == QUALITY_LOW ? zoomY : zoomY * text_scaling;
+  DeviceTextExtents ext = cached_text_extents(dc, text);
+  widths.reserve(ext.widths.size());
+  FOR_EACH_CONST(w, ext.widths) {
+    widths.push_back(w / sx);
+  }
+  return RealSize(ext.w / sx, ext.h / sy);
+}
+
 double RotatedDC::GetCharHeight() const {
   int h = dc.GetCharHeight();
   #ifdef __WXGTK__
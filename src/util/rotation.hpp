@@ -199,6 +199,12 @@ public:
   double getFontSizeStep() const;
   
   RealSize GetTextExtent(const String& text) const;
+  /// Get the widths of all prefixes of a text, widths[i] is the width of text.substr(0,i+1)
+  /** Measures the whole text at once, instead of each prefix separately.
+   *  The results are cached per font, so measuring the same text again is cheap.
+   *  Returns the extent of the whole text.
+   */
+  RealSize GetPartialTextExtents(const String& text, vector<double>& widths) const;
   double GetCharHeight() const;
   
   void SetClippingRegion(const RealRect& rect);
@@ -210,9 +216,13 @@ public:
   Bitmap GetBackground(const RealRect& r);
   
   inline wxDC& getDC() { return dc; }
+  inline RenderQuality getQuality() const { return quality; }
   
 private:
   wxDC& dc;        ///< The actual dc
   RenderQuality quality;  ///< Quality of the text
 };
 
+/// Forget the text extents cached by RotatedDC::GetPartialTextExtents, for benchmarks
+void clear_text_extent_cache();
+
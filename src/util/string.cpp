@@ -82,6 +82,13 @@ String reverse_string(String const& input) {
   return reversed;
 }
 
+String exact_double_key(double d) {
+  unsigned long long bits;
+  static_assert(sizeof(bits) == sizeof(d), "double should be 64 bits");
+  memcpy(&bits, &d, sizeof(d));
+  return String::Format(_("%llx"), bits);
+}
+
 // ----------------------------------------------------------------------------- : Caseing
 
 /// Quick check to see if the substring starting at the given iterator is equal to some given string
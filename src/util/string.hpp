@@ -196,6 +196,9 @@ String replace_all(const String& heystack, const String& needle, const String& r
 /// Reverses a string, Note: std::reverse doesn't work with wxString
 String reverse_string(String const& input);
 
+/// All bits of a double as a string, for use in a cache key; formatting with << rounds to a few digits
+String exact_double_key(double d);
+
 // ----------------------------------------------------------------------------- : Caseing
 
 /// Make each word in a string start with an upper case character.
@@ -0,0 +1,156 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <util/trace.hpp>
+#include <util/error.hpp>
+#include <wx/thread.h>
+#include <wx/file.h>
+
+using namespace std::chrono;
+
+// ----------------------------------------------------------------------------- : Trace events
+
+atomic<bool> trace_enabled(false);
+
+/// A completed scope
+struct TraceEvent {
+  const char* category;
+  const char* name;
+  String      detail;
+  long long   start;    ///< Microseconds since the start of the trace
+  long long   duration; ///< In microseconds
+  int         thread;
+};
+
+/// Maximum number of events to record, later events are dropped
+const size_t MAX_TRACE_EVENTS = 1 << 20;
+
+wxMutex                     trace_mutex;
+vector<TraceEvent>          trace_events;
+size_t                      trace_dropped = 0;
+steady_clock::time_point    trace_start_time;
+atomic<int>                 trace_thread_count(0);
+
+/// Small number identifying the current thread, the main thread is 0
+int trace_thread_id() {
+  static thread_local int id = wxThread::IsMain() ? 0 : ++trace_thread_count;
+  return id;
+}
+
+void trace_start() {
+  wxMutexLocker lock(trace_mutex);
+  trace_events.clear();
+  trace_dropped = 0;
+  trace_start_time = steady_clock::now();
+  trace_enabled = true;
+}
+
+void trace_stop() {
+  trace_enabled = false;
+}
+
+size_t trace_event_count() {
+  wxMutexLocker lock(trace_mutex);
+  return trace_events.size();
+}
+
+long long trace_total_time(const char* name) {
+  wxMutexLocker lock(trace_mutex);
+  long long total = 0;
+  FOR_EACH_CONST(e, trace_events) {
+    if (strcmp(e.name, name) == 0) total += e.duration;
+  }
+  return total;
+}
+
+void TraceScope::begin(const char* category, const char* name, const String& detail) {
+  this->category = category;
+  this->name     = name;
+  this->detail   = detail;
+  start = steady_clock::now();
+}
+
+void TraceScope::end() {
+  steady_clock::time_point end = steady_clock::now();
+  int thread = trace_thread_id();
+  wxMutexLocker lock(trace_mutex);
+  if (start < trace_start_time) return; // started before the trace was (re)started
+  if (trace_events.size() >= MAX_TRACE_EVENTS) {
+    trace_dropped++;
+    return;
+  }
+  trace_events.push_back(TraceEvent{
+    category, name, detail,
+    duration_cast<microseconds>(start - trace_start_time).count(),
+    duration_cast<microseconds>(end - start).count(),
+    thread
+  });
+}
+
+// ----------------------------------------------------------------------------- : Writing
+
+/// Append a string to json output, quoted and escaped
+void json_string(std::string& out, const char* str) {
+  out += '"';
+  for ( ; *str ; ++str) {
+    unsigned char c = *str;
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (c < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      out += buf;
+    } else {
+      out += c; // utf-8 bytes are written as they are
+    }
+  }
+  out += '"';
+}
+
+void trace_save(const String& filename) {
+  std::string out;
+  {
+    wxMutexLocker lock(trace_mutex);
+    out.reserve(trace_events.size() * 100 + 1000);
+    out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    // thread names
+    int threads = trace_thread_count;
+    for (int i = 0 ; i <= threads ; ++i) {
+      char buf[200];
+      snprintf(buf, sizeof(buf), "{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":\"%s %d\"}},\n",
+               i, i == 0 ? "main" : "worker", i);
+      out += buf;
+    }
+    // events
+    FOR_EACH_CONST(e, trace_events) {
+      char buf[200];
+      snprintf(buf, sizeof(buf), "{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%lld,\"dur\":%lld,\"cat\":",
+               e.thread, e.start, e.duration);
+      out += buf;
+      json_string(out, e.category);
+      out += ",\"name\":";
+      json_string(out, e.name);
+      if (!e.detail.empty()) {
+        out += ",\"args\":{\"detail\":";
+        json_string(out, e.detail.ToUTF8().data());
+        out += '}';
+      }
+      out += "},\n";
+    }
+    char buf[200];
+    snprintf(buf, sizeof(buf), "{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"Magic Set Editor\",\"dropped_events\":%u}}\n]}\n",
+             (unsigned)trace_dropped);
+    out += buf;
+  }
+  wxFile file;
+  if (!file.Create(filename, true) || !file.Write(out.data(), out.size())) {
+    throw Error(_("Unable to write trace file: ") + filename);
+  }
+}
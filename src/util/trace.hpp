@@ -0,0 +1,73 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#pragma once
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <atomic>
+#include <chrono>
+
+#ifndef USE_TRACING
+#define USE_TRACING 1
+#endif
+
+// ----------------------------------------------------------------------------- : Tracing
+
+/// Is a trace being recorded?
+/** When tracing is not enabled a TraceScope costs only the check of this flag. */
+extern atomic<bool> trace_enabled;
+
+/// Start recording a trace, discards any previously recorded events
+void trace_start();
+/// Stop recording, the recorded events are kept until the next trace_start
+void trace_stop();
+/// Write the recorded events to a file, in the Chrome trace event format (JSON)
+/** The file can be viewed with chrome://tracing or https://ui.perfetto.dev.
+ *  Throws an Error if the file can not be written.
+ */
+void trace_save(const String& filename);
+/// Number of recorded events
+size_t trace_event_count();
+/// Total duration in microseconds of the recorded events with the given name
+long long trace_total_time(const char* name);
+
+/// Record the time spent in the current scope in the trace
+/** category and name must be string literals (or otherwise outlive the trace),
+ *  detail is copied, but only if tracing is enabled.
+ */
+class TraceScope {
+public:
+  inline TraceScope(const char* category, const char* name)
+    : category(nullptr)
+  {
+    if (trace_enabled.load(memory_order_relaxed)) begin(category, name);
+  }
+  inline TraceScope(const char* category, const char* name, const String& detail)
+    : category(nullptr)
+  {
+    if (trace_enabled.load(memory_order_relaxed)) begin(category, name, detail);
+  }
+  inline ~TraceScope() {
+    if (category) end();
+  }
+private:
+  const char* category;
+  const char* name;
+  String      detail;
+  std::chrono::steady_clock::time_point start;
+
+  void begin(const char* category, const char* name, const String& detail = String());
+  void end();
+};
+
+#if USE_TRACING
+  /// Trace the rest of the current block, TRACE_SCOPE(category, name [, detail])
+  #define TRACE_SCOPE(...) TraceScope trace_scope(__VA_ARGS__)
+#else
+  #define TRACE_SCOPE(...)
+#endif
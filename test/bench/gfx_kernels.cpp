@@ -0,0 +1,203 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// Micro-benchmark for the image processing kernels in gfx/pixel_kernels.hpp
+// Checks that each kernel gives the same result as the straightforward loop,
+// and prints the throughput of both in megapixels per second.
+//
+// Usage: gfx-kernels-bench [width height [repetitions]]
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <gfx/pixel_kernels.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <vector>
+
+using namespace std;
+typedef unsigned char Byte;
+
+// ----------------------------------------------------------------------------- : Reference implementations
+
+// The loops as they were in gfx/blend_image.cpp and gfx/image_effects.cpp
+
+void linear_blend_ref(Byte* data1, const Byte* data2, int width, int height, int xm, int ym, int d) {
+  const int fixed = 1<<16;
+  for (int y = 0 ; y < height ; ++y) {
+    for (int x = 0 ; x < width ; ++x) {
+      int mult = x * xm + y * ym + d;
+      if (mult < 0)      mult = 0;
+      if (mult > fixed)  mult = fixed;
+      data1[0] = data1[0] + mult * (data2[0] - data1[0]) / fixed;
+      data1[1] = data1[1] + mult * (data2[1] - data1[1]) / fixed;
+      data1[2] = data1[2] + mult * (data2[2] - data1[2]) / fixed;
+      data1 += 3;
+      data2 += 3;
+    }
+  }
+}
+
+void mask_blend_ref(Byte* data1, const Byte* data2, const Byte* mask, size_t n) {
+  for (size_t i = 0 ; i < n ; ++i) {
+    data1[i] = (data1[i] * mask[i] + data2[i] * (255 - mask[i])) / 255;
+  }
+}
+
+void multiply_ref(Byte* data, const Byte* factor, size_t n) {
+  for (size_t i = 0 ; i < n ; ++i) {
+    data[i] = (data[i] * factor[i]) / 255;
+  }
+}
+
+void multiply_ref(Byte* data, Byte factor, size_t n) {
+  for (size_t i = 0 ; i < n ; ++i) {
+    data[i] = (data[i] * factor) / 255;
+  }
+}
+
+void invert_ref(Byte* data, size_t n) {
+  for (size_t i = 0 ; i < n ; ++i) {
+    data[i] = 255 - data[i];
+  }
+}
+
+inline Byte col(int x) { return (Byte)(x < 0 ? 0 : x > 255 ? 255 : x); }
+
+void saturate_ref(Byte* pix, size_t count, int factor) {
+  Byte* end = pix + 3 * count;
+  if (factor == 0) {
+  } else if (factor == 256) {
+    for ( ; pix != end ; pix += 3) {
+      int r = pix[0], g = pix[1], b = pix[2];
+      pix[0] = r+r > g+b ? 255 : 0;
+      pix[1] = g+g > b+r ? 255 : 0;
+      pix[2] = b+b > r+g ? 255 : 0;
+    }
+  } else if (factor > 0) {
+    int div = 768 - 3 * factor;
+    for ( ; pix != end ; pix += 3) {
+      int r = pix[0], g = pix[1], b = pix[2];
+      int avg = factor*(r+g+b);
+      pix[0] = col((768*r - avg) / div);
+      pix[1] = col((768*g - avg) / div);
+      pix[2] = col((768*b - avg) / div);
+    }
+  } else {
+    int factor1 = -factor;
+    int factor2 = 768 - 3*factor1;
+    for ( ; pix != end ; pix += 3) {
+      int r = pix[0], g = pix[1], b = pix[2];
+      int avg = factor1*(r+g+b);
+      pix[0] = (factor2*r + avg) / 768;
+      pix[1] = (factor2*g + avg) / 768;
+      pix[2] = (factor2*b + avg) / 768;
+    }
+  }
+}
+
+void recolor_ref(Byte* pix, size_t count, const Byte* cr, const Byte* cg, const Byte* cb, const Byte* cw) {
+  Byte* end = pix + 3 * count;
+  for ( ; pix != end ; pix += 3) {
+    int lo = min(pix[0], min(pix[1], pix[2]));
+    int nr = pix[0] - lo, ng = pix[1] - lo, nb = pix[2] - lo, nw = lo;
+    int total = max(255, nr+ng+nb+nw);
+    for (int c = 0 ; c < 3 ; ++c) {
+      pix[c] = (Byte)((nr * cr[c] + ng * cg[c] + nb * cb[c] + nw * cw[c]) / total);
+    }
+  }
+}
+
+// ----------------------------------------------------------------------------- : Benchmark
+
+int width = 750, height = 1050, repetitions = 20;
+// parameters of the kernels, globals so the compiler can't specialize the reference loops for them
+int saturate_factor = 128, desaturate_factor = -128;
+Byte alpha_factor = 128;
+size_t pixels;
+vector<Byte> image1, image2, mask, alpha;
+bool all_ok = true;
+
+/// Run f on a fresh copy of image1 (and alpha), return the time in seconds
+double time(const function<void(Byte*,Byte*)>& f, vector<Byte>& result, vector<Byte>& result_alpha) {
+  double best = 1e100;
+  for (int i = 0 ; i < repetitions ; ++i) {
+    result = image1;
+    result_alpha = alpha;
+    auto start = chrono::steady_clock::now();
+    f(result.data(), result_alpha.data());
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    if (elapsed.count() < best) best = elapsed.count();
+  }
+  return best;
+}
+
+void bench(const char* name, const function<void(Byte*,Byte*)>& reference, const function<void(Byte*,Byte*)>& kernel) {
+  vector<Byte> ref_out, ref_alpha, out, out_alpha;
+  double t_ref = time(reference, ref_out, ref_alpha);
+  double t_new = time(kernel,    out,     out_alpha);
+  bool ok = ref_out == out && ref_alpha == out_alpha;
+  all_ok &= ok;
+  double mp = pixels / 1e6;
+  printf("%-20s %10.1f MP/s %10.1f MP/s %6.2fx  %s\n", name, mp / t_ref, mp / t_new, t_ref / t_new, ok ? "ok" : "MISMATCH");
+}
+
+int main(int argc, char** argv) {
+  if (argc >= 3) {
+    width  = atoi(argv[1]);
+    height = atoi(argv[2]);
+  }
+  if (argc >= 4) repetitions = atoi(argv[3]);
+  if (width <= 0 || height <= 0 || repetitions <= 0) {
+    fprintf(stderr, "Usage: %s [width height [repetitions]]\n", argv[0]);
+    return 2;
+  }
+  pixels = (size_t)width * height;
+  // deterministic input
+  mt19937 rng(12345);
+  uniform_int_distribution<int> byte(0, 255);
+  image1.resize(3 * pixels); image2.resize(3 * pixels); mask.resize(3 * pixels); alpha.resize(pixels);
+  for (auto& b : image1) b = (Byte)byte(rng);
+  for (auto& b : image2) b = (Byte)byte(rng);
+  for (auto& b : mask)   b = (Byte)byte(rng);
+  for (auto& b : alpha)  b = (Byte)byte(rng);
+  // a blend from the top left to the bottom right, as set up by linear_blend
+  const int fixed = 1<<16;
+  double a = fixed / ((double)width * width + (double)height * height);
+  int xm = (int)(width * a), ym = (int)(height * a), d = 0;
+  const Byte cr[3] = {200,30,30}, cg[3] = {0,0,0}, cb[3] = {255,255,255}, cw[3] = {240,230,200};
+
+  printf("%d x %d pixels, best of %d\n", width, height, repetitions);
+  printf("%-20s %15s %15s %7s\n", "kernel", "reference", "new", "speedup");
+  bench("linear_blend",
+    [&](Byte* p, Byte*) { linear_blend_ref(p, image2.data(), width, height, xm, ym, d); },
+    [&](Byte* p, Byte*) { for (int y = 0 ; y < height ; ++y) linear_blend_row(p + 3*y*width, image2.data() + 3*y*width, width, y * ym + d, xm); });
+  bench("mask_blend",
+    [&](Byte* p, Byte*) { mask_blend_ref  (p, image2.data(), mask.data(), 3 * pixels); },
+    [&](Byte* p, Byte*) { mask_blend_bytes(p, image2.data(), mask.data(), 3 * pixels); });
+  bench("set_alpha(mask)",
+    [&](Byte*, Byte* al) { multiply_ref  (al, mask.data(), pixels); },
+    [&](Byte*, Byte* al) { multiply_bytes(al, mask.data(), pixels); });
+  bench("set_alpha(amount)",
+    [&](Byte*, Byte* al) { multiply_ref  (al, alpha_factor, pixels); },
+    [&](Byte*, Byte* al) { multiply_bytes(al, alpha_factor, pixels); });
+  bench("invert",
+    [&](Byte* p, Byte*) { invert_ref  (p, 3 * pixels); },
+    [&](Byte* p, Byte*) { invert_bytes(p, 3 * pixels); });
+  bench("saturate(+0.5)",
+    [&](Byte* p, Byte*) { saturate_ref   (p, pixels, saturate_factor); },
+    [&](Byte* p, Byte*) { saturate_pixels(p, pixels, saturate_factor); });
+  bench("saturate(-0.5)",
+    [&](Byte* p, Byte*) { saturate_ref   (p, pixels, desaturate_factor); },
+    [&](Byte* p, Byte*) { saturate_pixels(p, pixels, desaturate_factor); });
+  bench("recolor",
+    [&](Byte* p, Byte*) { recolor_ref   (p, pixels, cr, cg, cb, cw); },
+    [&](Byte* p, Byte*) { recolor_pixels(p, pixels, cr, cg, cb, cw); });
+  return all_ok ? 0 : 1;
+}
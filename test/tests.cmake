@@ -15,6 +15,36 @@ add_test(
   NAME script-functions
   COMMAND magicseteditor ${test_dir}/script/script-functions.mse-script
 )
+add_test(
+  NAME script-card-order
+  COMMAND magicseteditor --packages ${test_dir}/script/data ${test_dir}/script/card-order.mse-script ${test_dir}/script/data/card-order.mse-set
+)
+add_test(
+  NAME script-card-batch
+  COMMAND magicseteditor --packages ${test_dir}/script/data ${test_dir}/script/card-batch.mse-script ${test_dir}/script/data/card-order.mse-set
+)
+add_test(
+  NAME script-package-save
+  COMMAND magicseteditor --packages ${test_dir}/script/data ${test_dir}/script/package-save.mse-script ${test_dir}/script/data/package-save.mse-set
+)
 
 # Rendering tests
 # TODO
+
+# Benchmarks, not built by default
+# Image processing kernels, use: cmake --build . --target gfx-kernels-bench && ./gfx-kernels-bench [width height [repetitions]]
+add_executable(gfx-kernels-bench EXCLUDE_FROM_ALL
+  ${test_dir}/bench/gfx_kernels.cpp
+  ${PROJECT_SOURCE_DIR}/src/gfx/pixel_kernels.cpp
+)
+
+# Throughput of loading, saving, scripts, keywords, text layout and rendering,
+# use: cmake --build . --target magicseteditor-bench, the results are written to bench-results.jsonl
+set(BENCH_CARDS 500 CACHE STRING "Number of cards in the sets generated for magicseteditor-bench")
+set(BENCH_REPEAT 3 CACHE STRING "Number of repetitions of each benchmark in magicseteditor-bench")
+add_custom_target(magicseteditor-bench
+  COMMAND magicseteditor --bench "${test_dir}/bench/data" --cards ${BENCH_CARDS} --repeat ${BENCH_REPEAT} --output "${CMAKE_BINARY_DIR}/bench-results.jsonl"
+  DEPENDS magicseteditor
+  WORKING_DIRECTORY "${CMAKE_BINARY_DIR}"
+  USES_TERMINAL
+)